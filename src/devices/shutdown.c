@@ -4,11 +4,18 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/swap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
@@ -123,6 +130,10 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  lockstat_print ();
+  workqueue_print_stats ();
+  intr_print_stats ();
+  irqsoff_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -131,4 +142,8 @@ print_stats (void)
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+#ifdef VM
+  frame_print_stats ();
+  swap_print_stats ();
+#endif
 }
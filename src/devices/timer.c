@@ -1,6 +1,7 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
@@ -20,15 +21,51 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* List of threads sleeping in timer_sleep(), in order of
+   increasing wakeup_tick.  Threads are removed from the list and
+   unblocked by timer_interrupt() once their deadline arrives.
+   Protected by disabling interrupts. */
+static struct list sleep_list;
+
+/* If true, the idle thread stops the periodic timer interrupt
+   while nothing is runnable.  Controlled by kernel command-line
+   option "-tickless". */
+bool timer_tickless;
+
+/* PIT cycles per timer tick. */
+#define PIT_COUNT_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest idle period, in ticks, that fits in the PIT's 16-bit
+   counter.  About 5 ticks at 100 Hz. */
+#define ONESHOT_MAX_TICKS (UINT16_MAX / PIT_COUNT_PER_TICK)
+
+/* Length, in ticks, of the one-shot period programmed by
+   timer_idle_enter(), or 0 if the PIT is in periodic mode. */
+static int oneshot_ticks;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Number of time-stamp counter cycles per second, or 0 before
+   timer_calibrate() has measured it. */
+static uint64_t cycles_per_sec;
+
+/* Number of ticks over which the time-stamp counter is
+   calibrated against the PIT. */
+#define TSC_CALIBRATE_TICKS 4
+
+#define NSEC_PER_SEC 1000000000ULL
+
 static intr_handler_func timer_interrupt;
+static bool wakeup_less (const struct list_elem *,
+                         const struct list_elem *, void *aux);
+static void wake_sleepers (void);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void calibrate_tsc (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
@@ -36,6 +73,7 @@ void
 timer_init (void) 
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
+  list_init (&sleep_list);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -64,6 +102,70 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  calibrate_tsc ();
+}
+
+/* Measures the rate of the CPU's time-stamp counter against
+   TSC_CALIBRATE_TICKS timer ticks, setting cycles_per_sec. */
+static void
+calibrate_tsc (void) 
+{
+  int64_t start;
+  uint64_t start_cycles;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  /* Start counting on a tick boundary. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+  start = ticks;
+  start_cycles = timer_cycles ();
+
+  while (ticks - start < TSC_CALIBRATE_TICKS)
+    barrier ();
+  cycles_per_sec = ((timer_cycles () - start_cycles)
+                    * TIMER_FREQ / TSC_CALIBRATE_TICKS);
+
+  printf ("Time-stamp counter: %'"PRIu64" cycles/s.\n", cycles_per_sec);
+}
+
+/* Returns the current value of the CPU's time-stamp counter,
+   which increments at a constant rate (see timer_ns()) and never
+   goes backward.  Reading it takes only a few cycles, so it is
+   suitable for timing short events. */
+uint64_t
+timer_cycles (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Converts CYCLES, a difference between two values returned by
+   timer_cycles(), to nanoseconds.  Before timer_calibrate() has
+   run, returns 0. */
+uint64_t
+timer_cycles_to_ns (uint64_t cycles) 
+{
+  if (cycles_per_sec == 0)
+    return 0;
+
+  /* Split the conversion to avoid overflowing 64 bits. */
+  return (cycles / cycles_per_sec * NSEC_PER_SEC
+          + cycles % cycles_per_sec * NSEC_PER_SEC / cycles_per_sec);
+}
+
+/* Returns a monotonic clock reading in nanoseconds since some
+   arbitrary point, based on the time-stamp counter.  Before
+   timer_calibrate() has run, falls back to the tick count. */
+uint64_t
+timer_ns (void) 
+{
+  if (cycles_per_sec == 0)
+    return timer_ticks () * (NSEC_PER_SEC / TIMER_FREQ);
+  return timer_cycles_to_ns (timer_cycles ());
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -85,15 +187,26 @@ timer_elapsed (int64_t then)
 }
 
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.
+
+   The calling thread is blocked on sleep_list rather than
+   yielding in a loop, so it consumes no CPU time until
+   timer_interrupt() wakes it at its deadline. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  cur->wakeup_tick = ticks + timer_ticks ();
+  list_insert_ordered (&sleep_list, &cur->elem, wakeup_less, NULL);
+  thread_block ();
+  intr_set_level (old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -159,6 +272,73 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, just before
+   it halts the CPU.  In tickless mode, replaces the periodic
+   timer interrupt by a single interrupt at the next sleeper's
+   deadline, so that an idle CPU is not woken every tick. */
+void
+timer_idle_enter (void) 
+{
+  int64_t idle_ticks = ONESHOT_MAX_TICKS;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless)
+    return;
+
+  if (!list_empty (&sleep_list)) 
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick - ticks < idle_ticks)
+        idle_ticks = t->wakeup_tick - ticks;
+    }
+
+  /* Not worth leaving periodic mode for a single tick. */
+  if (idle_ticks < 2)
+    return;
+
+  oneshot_ticks = idle_ticks;
+  pit_configure_oneshot (idle_ticks * PIT_COUNT_PER_TICK);
+}
+
+/* Called at the start of every external interrupt.  If the CPU
+   was idling in tickless mode, credits the ticks that went by
+   since timer_idle_enter(), running the normal per-tick work
+   for each, and puts the PIT back into periodic mode.  Up to a
+   tick of time may be lost when a device interrupt ends the
+   idle period early. */
+void
+timer_idle_exit (void) 
+{
+  int elapsed;
+
+  ASSERT (intr_context ());
+
+  if (oneshot_ticks == 0)
+    return;
+
+  if (pit_output_high (0))
+    {
+      /* The whole period ran out.  The timer interrupt that
+         signals this counts the last tick itself. */
+      elapsed = oneshot_ticks - 1;
+    }
+  else
+    elapsed = ((oneshot_ticks * PIT_COUNT_PER_TICK - pit_read_counter (0))
+               / PIT_COUNT_PER_TICK);
+
+  oneshot_ticks = 0;
+  pit_configure_channel (0, 2, TIMER_FREQ);
+
+  while (elapsed-- > 0) 
+    {
+      ticks++;
+      thread_tick ();
+    }
+  wake_sleepers ();
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
@@ -171,7 +351,38 @@ static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
   ticks++;
+  wake_sleepers ();
   thread_tick ();
+  thread_check_preemption ();
+}
+
+/* Unblocks every thread on sleep_list whose deadline has
+   arrived.  Because the list is sorted by deadline, this only
+   looks at the threads that actually wake up, plus one. */
+static void
+wake_sleepers (void) 
+{
+  while (!list_empty (&sleep_list)) 
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+    }
+}
+
+/* Returns true if the thread containing A wakes up before the
+   thread containing B, false otherwise.  Threads with equal
+   deadlines keep their insertion order. */
+static bool
+wakeup_less (const struct list_elem *a, const struct list_elem *b,
+             void *aux UNUSED) 
+{
+  const struct thread *ta = list_entry (a, struct thread, elem);
+  const struct thread *tb = list_entry (b, struct thread, elem);
+  return ta->wakeup_tick < tb->wakeup_tick;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -235,12 +446,22 @@ real_time_sleep (int64_t num, int32_t denom)
     }
 }
 
-/* Busy-wait for approximately NUM/DENOM seconds. */
+/* Busy-wait for approximately NUM/DENOM seconds.  Once the
+   time-stamp counter is calibrated, waits until it reaches the
+   deadline, which is far more precise than counting loops. */
 static void
 real_time_delay (int64_t num, int32_t denom)
 {
   /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
   ASSERT (denom % 1000 == 0);
-  busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
+  if (cycles_per_sec != 0)
+    {
+      uint64_t start = timer_cycles ();
+      uint64_t cycles = cycles_per_sec * num / 1000 / (denom / 1000);
+      while (timer_cycles () - start < cycles)
+        barrier ();
+    }
+  else
+    busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
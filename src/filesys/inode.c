@@ -5,7 +5,9 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -57,11 +59,20 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and the open_cnt of its members.  Finding
+   an inode that is already open needs only read access; adding
+   or removing a list entry needs write access. */
+static struct rwlock open_inodes_lock;
+
+static void inode_get (struct inode *);
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  rwlock_init (&open_inodes_lock);
+  rwlock_set_name (&open_inodes_lock, "open_inodes");
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -113,23 +124,43 @@ inode_open (block_sector_t sector)
 {
   struct list_elem *e;
   struct inode *inode;
+  bool rescan = false;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  rwlock_acquire_read (&open_inodes_lock);
+  for (;;) 
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
+      for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+           e = list_next (e)) 
         {
-          inode_reopen (inode);
-          return inode; 
+          inode = list_entry (e, struct inode, elem);
+          if (inode->sector == sector) 
+            {
+              inode_get (inode);
+              if (rescan)
+                rwlock_release_write (&open_inodes_lock);
+              else
+                rwlock_release_read (&open_inodes_lock);
+              return inode; 
+            }
         }
+      if (rescan || rwlock_upgrade (&open_inodes_lock))
+        break;
+
+      /* Someone else is upgrading, so they may be opening this
+         very inode.  Wait for write access and look again. */
+      rwlock_release_read (&open_inodes_lock);
+      rwlock_acquire_write (&open_inodes_lock);
+      rescan = true;
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      rwlock_release_write (&open_inodes_lock);
+      return NULL;
+    }
 
   /* Initialize. */
   list_push_front (&open_inodes, &inode->elem);
@@ -138,6 +169,7 @@ inode_open (block_sector_t sector)
   inode->deny_write_cnt = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
+  rwlock_release_write (&open_inodes_lock);
   return inode;
 }
 
@@ -146,10 +178,25 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      rwlock_acquire_read (&open_inodes_lock);
+      inode_get (inode);
+      rwlock_release_read (&open_inodes_lock);
+    }
   return inode;
 }
 
+/* Adds a reference to INODE.  The caller must hold
+   open_inodes_lock, but other readers may hold it too, so the
+   increment itself must be atomic. */
+static void
+inode_get (struct inode *inode) 
+{
+  enum intr_level old_level = intr_disable ();
+  inode->open_cnt++;
+  intr_set_level (old_level);
+}
+
 /* Returns INODE's inode number. */
 block_sector_t
 inode_get_inumber (const struct inode *inode)
@@ -168,10 +215,12 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
+  rwlock_acquire_write (&open_inodes_lock);
   if (--inode->open_cnt == 0)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      rwlock_release_write (&open_inodes_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -183,6 +232,8 @@ inode_close (struct inode *inode)
 
       free (inode); 
     }
+  else
+    rwlock_release_write (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
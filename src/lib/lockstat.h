@@ -0,0 +1,33 @@
+#ifndef __LIB_LOCKSTAT_H
+#define __LIB_LOCKSTAT_H
+
+/* Lock contention statistics, shared between the kernel and
+   user programs through the lockstat() system call.
+
+   Only locks, semaphores and readers-writer locks that have been
+   given a name are tracked.  Objects that share a name, such as
+   the per-size-class malloc locks, share a single entry. */
+
+#include <stdint.h>
+
+/* Maximum length of a lock name, not including the null
+   terminator. */
+#define LOCKSTAT_NAME_MAX 15
+
+/* Maximum number of distinct names tracked. */
+#define LOCKSTAT_MAX 32
+
+/* Statistics for one named lock.  Times are in nanoseconds.
+   Hold time is not tracked for semaphores, which have no owner,
+   or for read access to readers-writer locks. */
+struct lockstat
+  {
+    char name[LOCKSTAT_NAME_MAX + 1];   /* Name. */
+    uint64_t acquisitions;              /* Successful acquisitions. */
+    uint64_t contentions;               /* Acquisitions that had to wait. */
+    uint64_t wait_ns;                   /* Total time spent waiting. */
+    uint64_t max_wait_ns;               /* Longest single wait. */
+    uint64_t hold_ns;                   /* Total time held. */
+  };
+
+#endif /* lib/lockstat.h */
@@ -0,0 +1,39 @@
+#ifndef __LIB_SCHED_STATS_H
+#define __LIB_SCHED_STATS_H
+
+/* Scheduler statistics, shared between the kernel and user
+   programs through the sched_stats() system call.  Passing 0
+   as the pid to sched_stats() selects the calling thread. */
+
+#include <stdint.h>
+
+/* Number of buckets in the scheduling latency histogram.
+   Bucket 0 counts latencies of 0 ns; bucket I, for I > 0,
+   counts latencies in [2**(I-1), 2**I) ns; the last bucket also
+   counts everything longer.  The kernel buckets latencies by
+   time-stamp counter cycles and regroups them by nanoseconds
+   only when reporting them, so bucket boundaries are accurate
+   to within a factor of 2. */
+#define SCHED_LATENCY_BUCKETS 32
+
+/* Per-thread scheduler counters.  All times are in nanoseconds,
+   as measured by the kernel's time-stamp counter clock. */
+struct sched_thread_stats
+  {
+    uint64_t voluntary_switches;    /* Switched out by blocking. */
+    uint64_t involuntary_switches;  /* Switched out while still ready. */
+    uint64_t run_ns;                /* Time spent running. */
+    uint64_t ready_ns;              /* Time spent waiting to run. */
+    uint64_t blocked_ns;            /* Time spent blocked. */
+  };
+
+/* What the sched_stats() system call reports: one thread's
+   counters plus a snapshot of the system-wide scheduling latency
+   histogram. */
+struct sched_stats
+  {
+    struct sched_thread_stats thread;           /* Requested thread. */
+    uint32_t latency_hist[SCHED_LATENCY_BUCKETS]; /* System-wide. */
+  };
+
+#endif /* lib/sched-stats.h */
@@ -28,7 +28,20 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_SCHED_STATS,            /* Reports scheduler statistics. */
+    SYS_TIME_NS,                /* Reads the high-resolution clock. */
+    SYS_LOCKSTAT,               /* Reports lock contention statistics. */
+    SYS_UTHREAD_CREATE,         /* Start a thread in this process. */
+    SYS_UTHREAD_JOIN,           /* Wait for a thread to exit. */
+    SYS_UTHREAD_EXIT,           /* Terminate the calling thread. */
+    SYS_UTHREAD_SELF,           /* Obtain the calling thread's id. */
+    SYS_FUTEX_WAIT,             /* Sleep while a word holds a value. */
+    SYS_FUTEX_WAKE,             /* Wake threads sleeping on a word. */
+    SYS_SCHED_EDF,              /* Join or leave the real-time class. */
+    SYS_INTR_STATS              /* Prints interrupt statistics. */
   };
 
 #endif /* lib/syscall-nr.h */
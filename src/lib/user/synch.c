@@ -0,0 +1,118 @@
+#include <synch.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* Atomically stores NEW in *P if *P equals OLD.  Returns the old
+   value of *P either way. */
+static inline int
+compare_and_swap (int *p, int old, int new)
+{
+  int prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* Atomically stores NEW in *P and returns the old value. */
+static inline int
+exchange (int *p, int new)
+{
+  asm volatile ("xchgl %0, %1"
+                : "+r" (new), "+m" (*p)
+                :
+                : "memory");
+  return new;
+}
+
+/* Atomically increments *P. */
+static inline void
+increment (int *p)
+{
+  asm volatile ("lock incl %0" : "+m" (*p) : : "memory");
+}
+
+/* Initializes mutex M as unlocked. */
+void
+mutex_init (struct mutex *m)
+{
+  m->state = 0;
+}
+
+/* Acquires M, sleeping until it is available if necessary.
+
+   This is the mutex from Drepper, "Futexes Are Tricky": a thread
+   that has to wait marks M as wanted (2) before sleeping, so that
+   mutex_unlock() calls into the kernel only when some thread may
+   be asleep. */
+void
+mutex_lock (struct mutex *m)
+{
+  int c = compare_and_swap (&m->state, 0, 1);
+  if (c != 0)
+    {
+      if (c != 2)
+        c = exchange (&m->state, 2);
+      while (c != 0)
+        {
+          futex_wait (&m->state, 2);
+          c = exchange (&m->state, 2);
+        }
+    }
+}
+
+/* Acquires M if it is available, without sleeping.  Returns true
+   if successful, false otherwise. */
+bool
+mutex_trylock (struct mutex *m)
+{
+  return compare_and_swap (&m->state, 0, 1) == 0;
+}
+
+/* Releases M, which the calling thread must hold. */
+void
+mutex_unlock (struct mutex *m)
+{
+  if (exchange (&m->state, 0) == 2)
+    futex_wake (&m->state, 1);
+}
+
+/* Initializes condition variable CV. */
+void
+condvar_init (struct condvar *cv)
+{
+  cv->seq = 0;
+}
+
+/* Atomically releases M, which the calling thread must hold, and
+   waits for CV to be signaled, then reacquires M.  As with kernel
+   condition variables, the caller must recheck its condition
+   afterward, since a wakeup may be spurious. */
+void
+condvar_wait (struct condvar *cv, struct mutex *m)
+{
+  int seq = cv->seq;
+
+  /* A signal after this unlock changes SEQ, so futex_wait()
+     returns at once instead of sleeping through it. */
+  mutex_unlock (m);
+  futex_wait (&cv->seq, seq);
+  mutex_lock (m);
+}
+
+/* Wakes one thread waiting on CV, if any. */
+void
+condvar_signal (struct condvar *cv)
+{
+  increment (&cv->seq);
+  futex_wake (&cv->seq, 1);
+}
+
+/* Wakes all threads waiting on CV. */
+void
+condvar_broadcast (struct condvar *cv)
+{
+  increment (&cv->seq);
+  futex_wake (&cv->seq, INT_MAX);
+}
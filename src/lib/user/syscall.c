@@ -182,3 +182,80 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+sched_stats (pid_t pid, struct sched_stats *stats)
+{
+  return syscall2 (SYS_SCHED_STATS, pid, stats);
+}
+
+uint64_t
+time_ns (void)
+{
+  uint64_t ns;
+  syscall1 (SYS_TIME_NS, &ns);
+  return ns;
+}
+
+int
+lockstat (struct lockstat *stats, int max)
+{
+  return syscall2 (SYS_LOCKSTAT, stats, max);
+}
+
+/* Runs in each thread created by uthread_create(). */
+static void
+uthread_start (void (*func) (void *), void *aux) 
+{
+  func (aux);
+  uthread_exit (0);
+}
+
+tid_t
+uthread_create (void (*func) (void *), void *aux)
+{
+  return syscall3 (SYS_UTHREAD_CREATE, uthread_start, func, aux);
+}
+
+int
+uthread_join (tid_t tid)
+{
+  return syscall1 (SYS_UTHREAD_JOIN, tid);
+}
+
+void
+uthread_exit (int status)
+{
+  syscall1 (SYS_UTHREAD_EXIT, status);
+  NOT_REACHED ();
+}
+
+tid_t
+uthread_self (void)
+{
+  return syscall0 (SYS_UTHREAD_SELF);
+}
+
+int
+futex_wait (int *addr, int expected)
+{
+  return syscall2 (SYS_FUTEX_WAIT, addr, expected);
+}
+
+int
+futex_wake (int *addr, int cnt)
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+bool
+sched_edf (int period, int budget)
+{
+  return syscall2 (SYS_SCHED_EDF, period, budget);
+}
+
+void
+intr_stats (void)
+{
+  syscall0 (SYS_INTR_STATS);
+}
@@ -3,11 +3,17 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <lockstat.h>
+#include <sched-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
 /* Map region identifier. */
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
@@ -45,4 +51,17 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+bool sched_stats (pid_t, struct sched_stats *);
+uint64_t time_ns (void);
+int lockstat (struct lockstat *, int max);
+tid_t uthread_create (void (*) (void *), void *aux);
+int uthread_join (tid_t);
+void uthread_exit (int status) NO_RETURN;
+tid_t uthread_self (void);
+int futex_wait (int *, int expected);
+int futex_wake (int *, int cnt);
+bool sched_edf (int period, int budget);
+void intr_stats (void);
+
 #endif /* lib/user/syscall.h */
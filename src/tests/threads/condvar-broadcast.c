@@ -0,0 +1,75 @@
+/* Has many threads wait on a condition variable, then wakes
+   them all with cond_broadcast() and counts how often they have
+   to block again before they get the lock back, and how often
+   the broadcasting thread is preempted.  A broadcast should hand
+   the lock from one waiter to the next, not wake every waiter
+   only to put all but one of them back to sleep on the lock. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define WAITER_CNT 30
+
+static thread_func waiter_thread;
+static struct lock lock;
+static struct condition condition;
+static bool go;
+static int waiting, woken;
+static int extra_blocks;
+
+void
+test_condvar_broadcast (void) 
+{
+  struct thread *cur = thread_current ();
+  uint64_t preemptions;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&lock);
+  cond_init (&condition);
+
+  /* Each waiter has a higher priority than us, so it runs as
+     soon as it is created and goes to sleep on the condition. */
+  for (i = 0; i < WAITER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, PRI_DEFAULT + 1, waiter_thread, NULL);
+    }
+  msg ("%d threads waiting.", waiting);
+
+  preemptions = cur->sched_stats.involuntary_switches;
+  lock_acquire (&lock);
+  go = true;
+  cond_broadcast (&condition, &lock);
+  lock_release (&lock);
+
+  /* All the waiters have run to completion by now. */
+  msg ("%d threads woke up.", woken);
+  msg ("Waiters blocked %d extra times.", extra_blocks);
+  msg ("Main thread was preempted %d times.",
+       (int) (cur->sched_stats.involuntary_switches - preemptions));
+}
+
+static void
+waiter_thread (void *aux UNUSED) 
+{
+  struct thread *cur = thread_current ();
+  uint64_t blocks;
+
+  lock_acquire (&lock);
+  waiting++;
+  blocks = cur->sched_stats.voluntary_switches;
+  while (!go)
+    cond_wait (&condition, &lock);
+
+  /* Blocking on the condition itself is expected. */
+  extra_blocks += cur->sched_stats.voluntary_switches - blocks - 1;
+  woken++;
+  lock_release (&lock);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(condvar-broadcast) begin
+(condvar-broadcast) 30 threads waiting.
+(condvar-broadcast) 30 threads woke up.
+(condvar-broadcast) Waiters blocked 0 extra times.
+(condvar-broadcast) Main thread was preempted 1 times.
+(condvar-broadcast) end
+EOF
+pass;
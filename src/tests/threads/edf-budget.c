@@ -0,0 +1,60 @@
+/* Checks admission control for the earliest-deadline-first
+   class.  Then checks that an EDF thread with budget left runs
+   ahead of a PRI_MAX thread, and that once it has used up its
+   budget it falls back to its normal priority, letting the
+   PRI_MAX thread run. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func admit_thread;
+static thread_func high_thread;
+static struct semaphore admit_done;
+static volatile bool high_ran;
+
+static const char *
+yes_no (bool b) 
+{
+  return b ? "yes" : "no";
+}
+
+void
+test_edf_budget (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Main: 11/10 admitted: %s.", yes_no (thread_set_edf (10, 11)));
+  msg ("Main: 5/10 admitted: %s.", yes_no (thread_set_edf (10, 5)));
+
+  sema_init (&admit_done, 0);
+  thread_create ("admit", PRI_DEFAULT, admit_thread, NULL);
+  sema_down (&admit_done);
+  msg ("Main: 9/10 admitted: %s.", yes_no (thread_set_edf (10, 9)));
+
+  thread_create ("high", PRI_MAX, high_thread, NULL);
+  msg ("Main thread still running.");
+  while (!high_ran)
+    continue;
+  msg ("Main thread ran out of budget.");
+  thread_set_edf (0, 0);
+}
+
+static void
+admit_thread (void *aux UNUSED) 
+{
+  msg ("Child: 5/10 admitted: %s.", yes_no (thread_set_edf (10, 5)));
+  msg ("Child: 4/10 admitted: %s.", yes_no (thread_set_edf (10, 4)));
+  thread_set_edf (0, 0);
+  sema_up (&admit_done);
+}
+
+static void
+high_thread (void *aux UNUSED) 
+{
+  high_ran = true;
+  msg ("High-priority thread ran.");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-budget) begin
+(edf-budget) Main: 11/10 admitted: no.
+(edf-budget) Main: 5/10 admitted: yes.
+(edf-budget) Child: 5/10 admitted: no.
+(edf-budget) Child: 4/10 admitted: yes.
+(edf-budget) Main: 9/10 admitted: yes.
+(edf-budget) Main thread still running.
+(edf-budget) High-priority thread ran.
+(edf-budget) Main thread ran out of budget.
+(edf-budget) end
+EOF
+pass;
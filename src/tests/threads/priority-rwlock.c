@@ -0,0 +1,58 @@
+/* Tests that a readers-writer lock prefers writers: a reader
+   that arrives while a writer is waiting must wait too, even
+   though the lock is only held for reading.  Then checks that
+   downgrading admits the waiting reader without letting go of
+   read access. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread;
+static thread_func reader_thread;
+static struct rwlock rwlock;
+
+void
+test_priority_rwlock (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_read (&rwlock);
+  msg ("Main thread has read access.");
+
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread, NULL);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread, NULL);
+
+  msg ("Main thread releasing read access.");
+  rwlock_release_read (&rwlock);
+  msg ("Main thread done.");
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  msg ("Writer waiting.");
+  rwlock_acquire_write (&rwlock);
+  msg ("Writer got write access.");
+  rwlock_downgrade (&rwlock);
+  msg ("Writer downgraded to read access.");
+  rwlock_release_read (&rwlock);
+  msg ("Writer done.");
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  msg ("Reader waiting.");
+  rwlock_acquire_read (&rwlock);
+  msg ("Reader got read access.");
+  rwlock_release_read (&rwlock);
+  msg ("Reader done.");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-rwlock) begin
+(priority-rwlock) Main thread has read access.
+(priority-rwlock) Writer waiting.
+(priority-rwlock) Reader waiting.
+(priority-rwlock) Main thread releasing read access.
+(priority-rwlock) Writer got write access.
+(priority-rwlock) Writer downgraded to read access.
+(priority-rwlock) Writer done.
+(priority-rwlock) Reader got read access.
+(priority-rwlock) Reader done.
+(priority-rwlock) Main thread done.
+(priority-rwlock) end
+EOF
+pass;
@@ -0,0 +1,55 @@
+/* Has several threads increment a shared counter under a
+   user-space mutex, while the main thread waits on a condition
+   variable for them to finish. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITER_CNT 1000
+
+static struct mutex mutex = MUTEX_INITIALIZER;
+static struct condvar finished_cv = CONDVAR_INITIALIZER;
+static int counter;
+static int finished;
+
+static void
+worker (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++) 
+    {
+      volatile int *p = &counter;
+      mutex_lock (&mutex);
+      *p = *p + 1;
+      mutex_unlock (&mutex);
+    }
+
+  mutex_lock (&mutex);
+  finished++;
+  condvar_signal (&finished_cv);
+  mutex_unlock (&mutex);
+}
+
+void
+test_main (void) 
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = uthread_create (worker, NULL)) != TID_ERROR,
+           "create thread %d", i);
+
+  mutex_lock (&mutex);
+  while (finished < THREAD_CNT)
+    condvar_wait (&finished_cv, &mutex);
+  mutex_unlock (&mutex);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    uthread_join (tids[i]);
+  CHECK (counter == THREAD_CNT * ITER_CNT, "counter is %d", counter);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-mutex) begin
+(futex-mutex) create thread 0
+(futex-mutex) create thread 1
+(futex-mutex) create thread 2
+(futex-mutex) create thread 3
+(futex-mutex) counter is 4000
+(futex-mutex) end
+futex-mutex: exit(0)
+EOF
+pass;
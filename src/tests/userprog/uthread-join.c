@@ -0,0 +1,42 @@
+/* Creates several threads in one process, each of which stores
+   a result in memory shared with the main thread and exits with
+   its own status, then joins them all. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+
+static int results[THREAD_CNT];
+
+static void
+worker (void *aux) 
+{
+  int i = (int) aux;
+
+  results[i] = i * i;
+  uthread_exit (i + 10);
+}
+
+void
+test_main (void) 
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = uthread_create (worker, (void *) i)) != TID_ERROR,
+           "create thread %d", i);
+  CHECK (uthread_join (uthread_self ()) == -1, "join self fails");
+
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      int status = uthread_join (tids[i]);
+      if (status != i + 10)
+        fail ("thread %d exited with %d, expected %d", i, status, i + 10);
+      if (results[i] != i * i)
+        fail ("thread %d stored %d, expected %d", i, results[i], i * i);
+    }
+  msg ("joined %d threads", THREAD_CNT);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-join) begin
+(uthread-join) create thread 0
+(uthread-join) create thread 1
+(uthread-join) create thread 2
+(uthread-join) create thread 3
+(uthread-join) join self fails
+(uthread-join) joined 4 threads
+(uthread-join) end
+uthread-join: exit(0)
+EOF
+pass;
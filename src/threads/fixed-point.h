@@ -0,0 +1,128 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <debug.h>
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point arithmetic, for use by the 4.4BSD
+   scheduler.  The kernel does not save floating-point state, so
+   real numbers must be represented in integers instead.
+
+   A fixed-point number is stored in an int whose low FIX_Q_BITS
+   bits are the fractional part.  It is wrapped in a struct so
+   that the compiler catches accidental mixing of fixed-point
+   values and plain integers. */
+
+/* Number of fractional bits. */
+#define FIX_Q_BITS 14
+
+/* Scale factor: the fixed-point representation of 1. */
+#define FIX_F (1 << FIX_Q_BITS)
+
+/* A fixed-point number. */
+typedef struct
+  {
+    int f;
+  }
+fixed_point_t;
+
+/* Returns a fixed-point number with F as its internal value. */
+static inline fixed_point_t
+__mk_fix (int f)
+{
+  fixed_point_t x;
+  x.f = f;
+  return x;
+}
+
+/* Returns fixed-point number corresponding to integer N. */
+static inline fixed_point_t
+fix_int (int n)
+{
+  return __mk_fix (n * FIX_F);
+}
+
+/* Returns fixed-point number corresponding to N divided by D. */
+static inline fixed_point_t
+fix_frac (int n, int d)
+{
+  ASSERT (d != 0);
+  return __mk_fix ((int64_t) n * FIX_F / d);
+}
+
+/* Returns X rounded toward zero to the nearest integer. */
+static inline int
+fix_trunc (fixed_point_t x)
+{
+  return x.f / FIX_F;
+}
+
+/* Returns X rounded to the nearest integer. */
+static inline int
+fix_round (fixed_point_t x)
+{
+  return (x.f >= 0
+          ? (x.f + FIX_F / 2) / FIX_F
+          : (x.f - FIX_F / 2) / FIX_F);
+}
+
+/* Returns X + Y. */
+static inline fixed_point_t
+fix_add (fixed_point_t x, fixed_point_t y)
+{
+  return __mk_fix (x.f + y.f);
+}
+
+/* Returns X - Y. */
+static inline fixed_point_t
+fix_sub (fixed_point_t x, fixed_point_t y)
+{
+  return __mk_fix (x.f - y.f);
+}
+
+/* Returns X + N, for integer N. */
+static inline fixed_point_t
+fix_add_int (fixed_point_t x, int n)
+{
+  return __mk_fix (x.f + n * FIX_F);
+}
+
+/* Returns X * Y. */
+static inline fixed_point_t
+fix_mul (fixed_point_t x, fixed_point_t y)
+{
+  return __mk_fix ((int64_t) x.f * y.f / FIX_F);
+}
+
+/* Returns X * N, for integer N. */
+static inline fixed_point_t
+fix_scale (fixed_point_t x, int n)
+{
+  return __mk_fix (x.f * n);
+}
+
+/* Returns X / Y. */
+static inline fixed_point_t
+fix_div (fixed_point_t x, fixed_point_t y)
+{
+  ASSERT (y.f != 0);
+  return __mk_fix ((int64_t) x.f * FIX_F / y.f);
+}
+
+/* Returns X / N, for integer N. */
+static inline fixed_point_t
+fix_unscale (fixed_point_t x, int n)
+{
+  ASSERT (n != 0);
+  return __mk_fix (x.f / n);
+}
+
+/* Returns -1, 0 or 1 as X is less than, equal to or greater
+   than Y. */
+static inline int
+fix_compare (fixed_point_t x, fixed_point_t y)
+{
+  return x.f < y.f ? -1 : x.f > y.f;
+}
+
+#endif /* threads/fixed-point.h */
@@ -3,12 +3,17 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/process.h"
+#endif
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -37,6 +42,18 @@ static const char *intr_names[INTR_CNT];
    unexpected interrupt is one that has no registered handler. */
 static unsigned int unexpected_cnt[INTR_CNT];
 
+/* Per-vector statistics.  Cycle counts cover only the time spent
+   in the registered handler, which for internal interrupts that
+   sleep includes time blocked. */
+struct intr_stats
+  {
+    long long cnt;              /* Number of invocations. */
+    uint64_t cycles;            /* Total cycles in the handler. */
+    uint64_t max_cycles;        /* Longest single invocation. */
+    long long yields;           /* Yields forced on return. */
+  };
+static struct intr_stats intr_stats[INTR_CNT];
+
 /* External interrupts are those generated by devices outside the
    CPU, such as the timer.  External interrupts run with
    interrupts turned off, so they never nest, nor are they ever
@@ -59,6 +76,37 @@ static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
 static void unexpected_interrupt (const struct intr_frame *);
+
+/* Enabling and disabling interrupts on behalf of the code at
+   CALLER, for the interrupts-off tracer. */
+static enum intr_level enable (void *caller);
+static enum intr_level disable (void *caller);
+
+#ifdef IRQSOFF_TRACE
+/* Interrupts-off tracer.  Measures, in time-stamp counter
+   cycles, every window during which interrupts are off: from
+   intr_disable() or entry to an interrupt handler, to
+   intr_enable() or return from the handler.  Built only when
+   IRQSOFF_TRACE is defined ("make TRACE=irqsoff").
+
+   All of this state is accessed only with interrupts off. */
+#define IRQSOFF_CALLER __builtin_return_address (0)
+#define IRQSOFF_BUCKETS 32      /* Bucket I: [2**(I-1), 2**I) cycles. */
+
+static bool irqsoff_active;             /* In a window now? */
+static uint64_t irqsoff_start;          /* Cycle count when it began. */
+static void *irqsoff_start_caller;      /* Code that began it. */
+static uint64_t irqsoff_max;            /* Longest window, in cycles. */
+static void *irqsoff_max_start;         /* Code that began it. */
+static void *irqsoff_max_end;           /* Code that ended it. */
+static long long irqsoff_cnt;           /* Number of windows. */
+static uint32_t irqsoff_hist[IRQSOFF_BUCKETS];
+
+static void irqsoff_begin (void *caller);
+static void irqsoff_end (void *caller);
+#else
+#define IRQSOFF_CALLER NULL
+#endif
 
 /* Returns the current interrupt status. */
 enum intr_level
@@ -80,16 +128,38 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  return (level == INTR_ON
+          ? enable (IRQSOFF_CALLER)
+          : disable (IRQSOFF_CALLER));
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) 
+{
+  return enable (IRQSOFF_CALLER);
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void) 
+{
+  return disable (IRQSOFF_CALLER);
+}
+
+/* Enables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+enable (void *caller UNUSED) 
 {
   enum intr_level old_level = intr_get_level ();
   ASSERT (!intr_context ());
 
+#ifdef IRQSOFF_TRACE
+  if (old_level == INTR_OFF)
+    irqsoff_end (caller);
+#endif
+
   /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -99,9 +169,10 @@ intr_enable (void)
   return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable (void) 
+/* Disables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+disable (void *caller UNUSED) 
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,6 +181,11 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+#ifdef IRQSOFF_TRACE
+  if (old_level == INTR_ON)
+    irqsoff_begin (caller);
+#endif
+
   return old_level;
 }
 
@@ -346,6 +422,15 @@ intr_handler (struct intr_frame *frame)
 {
   bool external;
   intr_handler_func *handler;
+  struct intr_stats *stats = &intr_stats[frame->vec_no];
+  enum intr_level old_level;
+  uint64_t start, cycles;
+
+#ifdef IRQSOFF_TRACE
+  /* Interrupt gates turn interrupts off on entry. */
+  if (intr_get_level () == INTR_OFF)
+    irqsoff_begin (frame->eip);
+#endif
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
@@ -359,12 +444,27 @@ intr_handler (struct intr_frame *frame)
 
       in_external_intr = true;
       yield_on_return = false;
+
+      /* Catch up on ticks skipped while idling tickless. */
+      timer_idle_exit ();
     }
 
   /* Invoke the interrupt's handler. */
   handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
-    handler (frame);
+    {
+      start = timer_cycles ();
+      handler (frame);
+      cycles = timer_cycles () - start;
+
+      /* Internal interrupt handlers may run with interrupts on. */
+      old_level = intr_disable ();
+      stats->cnt++;
+      stats->cycles += cycles;
+      if (cycles > stats->max_cycles)
+        stats->max_cycles = cycles;
+      intr_set_level (old_level);
+    }
   else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
     {
       /* There is no handler, but this interrupt can trigger
@@ -384,7 +484,52 @@ intr_handler (struct intr_frame *frame)
       pic_end_of_interrupt (frame->vec_no); 
 
       if (yield_on_return) 
-        thread_yield (); 
+        {
+          stats->yields++;
+          thread_yield (); 
+        }
+    }
+
+#ifdef USERPROG
+  /* Threads of an exiting process exit instead of returning to
+     user mode. */
+  if (frame->cs == SEL_UCSEG)
+    process_check_exit ();
+#endif
+
+#ifdef IRQSOFF_TRACE
+  /* Returning to code that had interrupts on turns them back
+     on. */
+  if (frame->eflags & FLAG_IF && intr_get_level () == INTR_OFF)
+    irqsoff_end (intr_handler);
+#endif
+}
+
+/* Prints per-vector interrupt statistics, for each vector that
+   has been handled at least once. */
+void
+intr_print_stats (void) 
+{
+  int vec;
+
+  printf ("Interrupts:  vec %-20s %10s %12s %9s %9s %8s\n", "name",
+          "count", "total ns", "avg ns", "max ns", "yields");
+  for (vec = 0; vec < INTR_CNT; vec++) 
+    {
+      enum intr_level old_level;
+      struct intr_stats s;
+
+      old_level = intr_disable ();
+      s = intr_stats[vec];
+      intr_set_level (old_level);
+
+      if (s.cnt == 0)
+        continue;
+      printf ("            0x%02x %-20s %10lld %12"PRIu64" %9"PRIu64
+              " %9"PRIu64" %8lld\n",
+              vec, intr_names[vec], s.cnt, timer_cycles_to_ns (s.cycles),
+              timer_cycles_to_ns (s.cycles / s.cnt),
+              timer_cycles_to_ns (s.max_cycles), s.yields);
     }
 }
 
@@ -436,3 +581,98 @@ intr_name (uint8_t vec)
 {
   return intr_names[vec];
 }
+
+#ifdef IRQSOFF_TRACE
+/* Notes that CALLER is about to turn interrupts on by some means
+   other than intr_enable() or intr_set_level(), such as the idle
+   thread's "sti; hlt".  Interrupts must be off. */
+void
+irqsoff_mark_enabled (void *caller) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  irqsoff_end (caller);
+}
+
+/* Starts an interrupts-off window at CALLER, unless one is
+   already open. */
+static void
+irqsoff_begin (void *caller) 
+{
+  if (irqsoff_active)
+    return;
+  irqsoff_active = true;
+  irqsoff_start_caller = caller;
+  irqsoff_start = timer_cycles ();
+}
+
+/* Ends the current interrupts-off window, if any, at CALLER. */
+static void
+irqsoff_end (void *caller) 
+{
+  uint64_t cycles;
+  int bucket;
+
+  if (!irqsoff_active)
+    return;
+  irqsoff_active = false;
+  cycles = timer_cycles () - irqsoff_start;
+
+  irqsoff_cnt++;
+  if (cycles > irqsoff_max)
+    {
+      irqsoff_max = cycles;
+      irqsoff_max_start = irqsoff_start_caller;
+      irqsoff_max_end = caller;
+    }
+
+  if (cycles == 0)
+    bucket = 0;
+  else if (cycles > UINT32_MAX)
+    bucket = IRQSOFF_BUCKETS - 1;
+  else
+    bucket = 32 - __builtin_clz ((uint32_t) cycles);
+  if (bucket >= IRQSOFF_BUCKETS)
+    bucket = IRQSOFF_BUCKETS - 1;
+  irqsoff_hist[bucket]++;
+}
+
+/* Prints interrupts-off statistics.  The addresses where the
+   longest window began and ended are printed in the same form
+   as debug_backtrace(), so the `backtrace' utility can
+   translate them. */
+void
+irqsoff_print_stats (void) 
+{
+  enum intr_level old_level;
+  uint32_t hist[IRQSOFF_BUCKETS];
+  uint64_t max;
+  void *max_start, *max_end;
+  long long cnt;
+  int i;
+
+  old_level = intr_disable ();
+  memcpy (hist, irqsoff_hist, sizeof hist);
+  max = irqsoff_max;
+  max_start = irqsoff_max_start;
+  max_end = irqsoff_max_end;
+  cnt = irqsoff_cnt;
+  intr_set_level (old_level);
+
+  printf ("Interrupts off: %lld windows, longest %"PRIu64" ns "
+          "(%"PRIu64" cycles)\n", cnt, timer_cycles_to_ns (max), max);
+  printf ("Longest window began and ended at:\n");
+  printf ("Call stack: %p %p.\n", max_start, max_end);
+  printf ("Interrupts-off windows (ns):");
+  for (i = 0; i < IRQSOFF_BUCKETS; i++)
+    if (hist[i] != 0)
+      {
+        if (i == 0)
+          printf (" [0]=%"PRIu32, hist[i]);
+        else
+          printf (" [%"PRIu64",%"PRIu64")=%"PRIu32,
+                  timer_cycles_to_ns ((uint64_t) 1 << (i - 1)),
+                  timer_cycles_to_ns ((uint64_t) 1 << i), hist[i]);
+      }
+  printf ("\n");
+}
+#endif /* IRQSOFF_TRACE */
@@ -66,5 +66,15 @@ void intr_yield_on_return (void);
 
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
+void intr_print_stats (void);
+
+/* Interrupts-off tracer, built with "make TRACE=irqsoff". */
+#ifdef IRQSOFF_TRACE
+void irqsoff_mark_enabled (void *caller);
+void irqsoff_print_stats (void);
+#else
+#define irqsoff_mark_enabled(CALLER) ((void) 0)
+#define irqsoff_print_stats() ((void) 0)
+#endif
 
 #endif /* threads/interrupt.h */
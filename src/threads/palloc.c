@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -36,9 +37,32 @@ struct pool
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
+/* Cache of recycled kernel pages, so that creating and
+   destroying threads and page directories does not scan the
+   kernel pool's bitmap every time.  Freed pages go on the dirty
+   list; the idle thread zeroes them and moves them to the clean
+   list.  Pages freed while the cache is full go on the deferred
+   list, to be returned to the kernel pool later by a thread that
+   can acquire its lock.  Each list is threaded through the first
+   word of its pages.  All are protected by disabling interrupts,
+   since pages are recycled from thread_schedule_tail(), where
+   locks cannot be acquired. */
+struct recycled_page
+  {
+    struct recycled_page *next;
+  };
+
+/* Maximum number of pages held by the cache. */
+#define RECYCLED_PAGES_MAX 64
+
+static struct recycled_page *clean_pages, *dirty_pages, *deferred_pages;
+static size_t recycled_cnt;
+
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static bool free_deferred_pages (void);
+static bool drain_recycled_pages (void);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -81,6 +105,16 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
   lock_release (&pool->lock);
 
+  /* Before giving up on the kernel pool, return the pages held
+     by the recycled page cache to it and try again. */
+  if (page_idx == BITMAP_ERROR && pool == &kernel_pool
+      && drain_recycled_pages ()) 
+    {
+      lock_acquire (&pool->lock);
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+      lock_release (&pool->lock);
+    }
+
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
   else
@@ -162,6 +196,180 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Returns the kernel virtual address of the first page in the
+   user pool.  The user pool's pages are contiguous. */
+void *
+palloc_user_pool_base (void) 
+{
+  return user_pool.base;
+}
+
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_page_cnt (void) 
+{
+  return bitmap_size (user_pool.used_map);
+}
+
+/* Obtains a zeroed kernel page, preferring one from the recycled
+   page cache, and returns its kernel virtual address.  Returns a
+   null pointer if no pages are available.  Must not be called
+   with interrupts disabled.  The page may be freed
+   with palloc_free_page() or palloc_recycle_page(). */
+void *
+palloc_get_recycled_page (void) 
+{
+  struct recycled_page *page;
+  bool dirty = false;
+  enum intr_level old_level;
+
+  free_deferred_pages ();
+
+  old_level = intr_disable ();
+  page = clean_pages;
+  if (page != NULL)
+    clean_pages = page->next;
+  else if (dirty_pages != NULL)
+    {
+      page = dirty_pages;
+      dirty_pages = page->next;
+      dirty = true;
+    }
+  if (page != NULL)
+    recycled_cnt--;
+  intr_set_level (old_level);
+
+  if (page == NULL)
+    return palloc_get_page (PAL_ZERO);
+  if (dirty)
+    memset (page, 0, PGSIZE);
+  else
+    page->next = NULL;
+  return page;
+}
+
+/* Frees PAGE, which must have been obtained from the kernel
+   pool, into the recycled page cache.  If the cache is full, the
+   page is returned to the kernel pool later instead, by the next
+   palloc_get_recycled_page() or an allocation that runs short.
+
+   Unlike palloc_free_page(), does not acquire any locks, so it
+   may be called with interrupts disabled. */
+void
+palloc_recycle_page (void *page_) 
+{
+  struct recycled_page *page = page_;
+  enum intr_level old_level;
+
+  if (page == NULL)
+    return;
+  ASSERT (pg_ofs (page) == 0);
+  ASSERT (page_from_pool (&kernel_pool, page));
+
+  old_level = intr_disable ();
+  if (recycled_cnt < RECYCLED_PAGES_MAX)
+    {
+      page->next = dirty_pages;
+      dirty_pages = page;
+      recycled_cnt++;
+    }
+  else 
+    {
+      page->next = deferred_pages;
+      deferred_pages = page;
+    }
+  intr_set_level (old_level);
+}
+
+/* Zeroes one dirty page in the recycled page cache and moves it
+   to the clean list.  Returns true if there was a page to
+   scrub, false otherwise.  Called by the idle thread with
+   interrupts on. */
+bool
+palloc_scrub_page (void) 
+{
+  struct recycled_page *page;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  page = dirty_pages;
+  if (page != NULL)
+    {
+      dirty_pages = page->next;
+      recycled_cnt--;
+    }
+  intr_set_level (old_level);
+
+  if (page == NULL)
+    return false;
+
+  memset (page, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  page->next = clean_pages;
+  clean_pages = page;
+  recycled_cnt++;
+  intr_set_level (old_level);
+
+  return true;
+}
+
+/* Returns the pages on the deferred list to the kernel pool.
+   Returns true if there were any. */
+static bool
+free_deferred_pages (void) 
+{
+  struct recycled_page *page;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  page = deferred_pages;
+  deferred_pages = NULL;
+  intr_set_level (old_level);
+
+  if (page == NULL)
+    return false;
+  while (page != NULL) 
+    {
+      struct recycled_page *next = page->next;
+      palloc_free_page (page);
+      page = next;
+    }
+  return true;
+}
+
+/* Returns every page held by the recycled page cache, and the
+   deferred list, to the kernel pool.  Returns true if there were
+   any. */
+static bool
+drain_recycled_pages (void) 
+{
+  struct recycled_page *page;
+  enum intr_level old_level;
+  bool freed = free_deferred_pages ();
+
+  for (;;) 
+    {
+      old_level = intr_disable ();
+      page = clean_pages;
+      if (page != NULL)
+        clean_pages = page->next;
+      else if (dirty_pages != NULL) 
+        {
+          page = dirty_pages;
+          dirty_pages = page->next;
+        }
+      if (page != NULL)
+        recycled_cnt--;
+      intr_set_level (old_level);
+
+      if (page == NULL)
+        return freed;
+      palloc_free_page (page);
+      freed = true;
+    }
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -179,6 +387,7 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
 
   /* Initialize the pool. */
   lock_init (&p->lock);
+  lock_set_name (&p->lock, name);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
 }
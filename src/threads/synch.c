@@ -27,10 +27,31 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Maximum length of a chain of locks through which priority is
+   donated, e.g. H waits on a lock held by M, which waits on a
+   lock held by L. */
+#define DONATION_DEPTH_MAX 8
+
+static void sema_wake (struct semaphore *);
+static void lock_acquired (struct lock *, bool contended, uint64_t start);
+static void lock_drop (struct lock *);
+static void donate_priority (struct thread *);
+
+/* Statistics for named locks.  The first lockstat_cnt entries
+   are in use. */
+static struct lockstat lockstats[LOCKSTAT_MAX];
+static int lockstat_cnt;
+
+static struct lockstat *lockstat_register (const char *name);
+static void lockstat_acquired (struct lockstat *, bool contended,
+                               uint64_t wait_ns);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -48,6 +69,18 @@ sema_init (struct semaphore *sema, unsigned value)
 
   sema->value = value;
   list_init (&sema->waiters);
+  sema->stat = NULL;
+}
+
+/* Starts collecting contention statistics for SEMA under NAME.
+   A semaphore counts as contended when sema_down() has to
+   wait. */
+void
+sema_set_name (struct semaphore *sema, const char *name) 
+{
+  ASSERT (sema != NULL);
+
+  sema->stat = lockstat_register (name);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -61,17 +94,25 @@ void
 sema_down (struct semaphore *sema) 
 {
   enum intr_level old_level;
+  bool contended;
+  uint64_t start = 0;
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  contended = sema->value == 0;
+  if (sema->stat != NULL && contended)
+    start = timer_ns ();
   while (sema->value == 0) 
     {
       list_push_back (&sema->waiters, &thread_current ()->elem);
       thread_block ();
     }
   sema->value--;
+  if (sema->stat != NULL)
+    lockstat_acquired (sema->stat, contended,
+                       contended ? timer_ns () - start : 0);
   intr_set_level (old_level);
 }
 
@@ -93,6 +134,8 @@ sema_try_down (struct semaphore *sema)
     {
       sema->value--;
       success = true; 
+      if (sema->stat != NULL)
+        lockstat_acquired (sema->stat, false, 0);
     }
   else
     success = false;
@@ -102,7 +145,9 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.  Waiters of equal priority are woken in FIFO
+   order.
 
    This function may be called from an interrupt handler. */
 void
@@ -113,11 +158,27 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
+  sema_wake (sema);
+  intr_set_level (old_level);
+
+  thread_check_preemption ();
+}
+
+/* Does the work of sema_up() without yielding to the thread it
+   wakes.  Interrupts must be off. */
+static void
+sema_wake (struct semaphore *sema) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
   if (!list_empty (&sema->waiters)) 
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+    {
+      struct list_elem *e = list_max (&sema->waiters,
+                                      thread_priority_less, NULL);
+      list_remove (e);
+      thread_unblock (list_entry (e, struct thread, elem));
+    }
   sema->value++;
-  intr_set_level (old_level);
 }
 
 static void sema_test_helper (void *sema_);
@@ -179,12 +240,30 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->max_priority = PRI_MIN;
+  lock->stat = NULL;
+  lock->acquired_ns = 0;
+}
+
+/* Starts collecting contention statistics for LOCK under NAME.
+   Locks that share a name share statistics. */
+void
+lock_set_name (struct lock *lock, const char *name) 
+{
+  ASSERT (lock != NULL);
+
+  lock->stat = lockstat_register (name);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   If the lock is held by a lower-priority thread, the current
+   thread donates its priority to the holder, and transitively
+   to whatever the holder is itself waiting for, until the lock
+   is released.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -192,12 +271,59 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool contended;
+  uint64_t start = 0;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  contended = lock->holder != NULL;
+  if (lock->stat != NULL)
+    start = timer_ns ();
+  if (lock->holder != NULL && !thread_mlfqs)
+    {
+      cur->waiting_lock = lock;
+      donate_priority (cur);
+    }
+
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  lock_acquired (lock, contended, start);
+  intr_set_level (old_level);
+}
+
+/* Makes the running thread, which has just downed LOCK's
+   semaphore, LOCK's holder.  CONTENDED and START are as for
+   lockstat_acquired().  Interrupts must be off. */
+static void
+lock_acquired (struct lock *lock, bool contended, uint64_t start) 
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Threads still waiting now donate to us instead. */
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  lock->max_priority = PRI_MIN;
+  for (e = list_begin (&lock->semaphore.waiters);
+       e != list_end (&lock->semaphore.waiters); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, elem);
+      if (t->priority > lock->max_priority)
+        lock->max_priority = t->priority;
+    }
+  list_push_back (&cur->locks, &lock->elem);
+  thread_update_priority (cur);
+  if (lock->stat != NULL)
+    {
+      lock->acquired_ns = timer_ns ();
+      lockstat_acquired (lock->stat, contended, lock->acquired_ns - start);
+    }
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -209,18 +335,32 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      lock->max_priority = PRI_MIN;
+      list_push_back (&lock->holder->locks, &lock->elem);
+      if (lock->stat != NULL)
+        {
+          lock->acquired_ns = timer_ns ();
+          lockstat_acquired (lock->stat, false, 0);
+        }
+    }
+  intr_set_level (old_level);
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   Gives up any priority donated through LOCK, which may cause
+   the current thread to yield.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -228,11 +368,31 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  lock_drop (lock);
+  intr_set_level (old_level);
+
+  thread_check_preemption ();
+}
+
+/* Does the work of lock_release() without yielding to the thread
+   it wakes.  Interrupts must be off. */
+static void
+lock_drop (struct lock *lock) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (lock->stat != NULL)
+    lock->stat->hold_ns += timer_ns () - lock->acquired_ns;
+  list_remove (&lock->elem);
   lock->holder = NULL;
-  sema_up (&lock->semaphore);
+  thread_update_priority (thread_current ());
+  sema_wake (&lock->semaphore);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -246,12 +406,32 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
-struct semaphore_elem 
-  {
-    struct list_elem elem;              /* List element. */
-    struct semaphore semaphore;         /* This semaphore. */
-  };
+/* Donates T's priority along the chain of locks starting with
+   the one T is waiting for: each lock's holder is raised to at
+   least T's priority, and if that holder is itself waiting for a
+   lock, the donation continues through it, up to
+   DONATION_DEPTH_MAX levels.  Interrupts must be off. */
+static void
+donate_priority (struct thread *t) 
+{
+  int priority = t->priority;
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; depth < DONATION_DEPTH_MAX; depth++)
+    {
+      struct lock *lock = t->waiting_lock;
+      if (lock == NULL || lock->holder == NULL)
+        break;
+      if (lock->max_priority < priority)
+        lock->max_priority = priority;
+      t = lock->holder;
+      if (t->priority >= priority)
+        break;
+      thread_set_effective_priority (t, priority);
+    }
+}
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
@@ -287,43 +467,93 @@ cond_init (struct condition *cond)
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
-  struct semaphore_elem waiter;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  uint64_t start = 0;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
-  
-  sema_init (&waiter.semaphore, 0);
-  list_push_back (&cond->waiters, &waiter.elem);
-  lock_release (lock);
-  sema_down (&waiter.semaphore);
-  lock_acquire (lock);
+
+  old_level = intr_disable ();
+  list_push_back (&cond->waiters, &cur->elem);
+  lock_drop (lock);
+  thread_block ();
+
+  /* cond_signal() moved us from COND onto LOCK's wait queue, and
+     a lock_release() has now woken us from there.  Usually the
+     lock is ours, but a thread that called lock_acquire() since
+     can have beaten us to it, in which case we wait again,
+     donating our priority to the new holder as lock_acquire()
+     would. */
+  if (lock->stat != NULL)
+    start = timer_ns ();
+  while (lock->semaphore.value == 0)
+    {
+      list_push_back (&lock->semaphore.waiters, &cur->elem);
+      if (!thread_mlfqs)
+        {
+          cur->waiting_lock = lock;
+          donate_priority (cur);
+        }
+      thread_block ();
+    }
+  lock->semaphore.value--;
+  lock_acquired (lock, true, start);
+  intr_set_level (old_level);
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the highest-priority one to wake up from
+   its wait.  LOCK must be held before calling this function.
+
+   The signaled thread could not run anyway until it reacquired
+   LOCK, so instead of waking it we move it straight from COND's
+   wait queue to LOCK's ("wait morphing").  It runs once LOCK is
+   released, already holding LOCK, rather than waking only to
+   block again on LOCK.  Meanwhile it donates its priority to us
+   like any other thread waiting for LOCK.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
    interrupt handler. */
 void
-cond_signal (struct condition *cond, struct lock *lock UNUSED) 
+cond_signal (struct condition *cond, struct lock *lock) 
 {
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    {
+      struct list_elem *e = list_max (&cond->waiters,
+                                      thread_priority_less, NULL);
+      struct thread *t = list_entry (e, struct thread, elem);
+
+      list_remove (e);
+      list_push_back (&lock->semaphore.waiters, e);
+      if (!thread_mlfqs)
+        {
+          t->waiting_lock = lock;
+          donate_priority (t);
+        }
+    }
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
    LOCK).  LOCK must be held before calling this function.
 
+   Each waiter is morphed onto LOCK's wait queue as by
+   cond_signal(), so the waiters then run one at a time as LOCK
+   passes from one to the next, instead of all waking at once to
+   fight over LOCK.
+
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
    interrupt handler. */
@@ -336,3 +566,442 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+static void rwlock_grant (struct rwlock *);
+
+/* Initializes RW as a readers-writer lock.  Any number of
+   threads may hold read access at once, or a single thread may
+   hold write access.
+
+   Writers are preferred: once a writer is waiting, new readers
+   wait behind it, so a steady stream of readers cannot starve
+   writers.  When the lock becomes free and both readers and
+   writers are waiting, the writer gets it unless a waiting
+   reader has strictly higher priority.
+
+   Unlike a lock, a readers-writer lock does not donate
+   priority, since it has no single holder for read access. */
+void
+rwlock_init (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  rw->readers = 0;
+  rw->writer = NULL;
+  rw->upgrader = NULL;
+  list_init (&rw->read_waiters);
+  list_init (&rw->write_waiters);
+  rw->stat = NULL;
+  rw->acquired_ns = 0;
+}
+
+/* Starts collecting contention statistics for RW under NAME.
+   Read and write acquisitions are counted together; hold time
+   is counted for write access only. */
+void
+rwlock_set_name (struct rwlock *rw, const char *name) 
+{
+  ASSERT (rw != NULL);
+
+  rw->stat = lockstat_register (name);
+}
+
+/* Acquires read access to RW, sleeping until no thread holds or
+   is waiting for write access.  The current thread must not
+   already hold RW: a thread that re-acquires read access could
+   deadlock behind a waiting writer.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != cur);
+
+  old_level = intr_disable ();
+  if (rw->writer != NULL || rw->upgrader != NULL
+      || !list_empty (&rw->write_waiters))
+    {
+      uint64_t start = rw->stat != NULL ? timer_ns () : 0;
+
+      /* rwlock_grant() counts us as a reader before waking us. */
+      list_push_back (&rw->read_waiters, &cur->elem);
+      thread_block ();
+      if (rw->stat != NULL)
+        lockstat_acquired (rw->stat, true, timer_ns () - start);
+    }
+  else
+    {
+      rw->readers++;
+      if (rw->stat != NULL)
+        lockstat_acquired (rw->stat, false, 0);
+    }
+  cur->rwlock_reads++;
+  intr_set_level (old_level);
+}
+
+/* Tries to acquire read access to RW without sleeping.  Returns
+   true if successful, false on failure. */
+bool
+rwlock_try_acquire_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  success = (rw->writer == NULL && rw->upgrader == NULL
+             && list_empty (&rw->write_waiters));
+  if (success)
+    {
+      rw->readers++;
+      thread_current ()->rwlock_reads++;
+      if (rw->stat != NULL)
+        lockstat_acquired (rw->stat, false, 0);
+    }
+  intr_set_level (old_level);
+  return success;
+}
+
+/* Releases read access to RW, which the current thread must
+   hold. */
+void
+rwlock_release_read (struct rwlock *rw) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  ASSERT (cur->rwlock_reads > 0);
+  rw->readers--;
+  cur->rwlock_reads--;
+  rwlock_grant (rw);
+  intr_set_level (old_level);
+
+  thread_check_preemption ();
+}
+
+/* Acquires write access to RW, sleeping until no other thread
+   holds it for reading or writing.  The current thread must not
+   already hold RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != cur);
+
+  old_level = intr_disable ();
+  if (rw->writer != NULL || rw->readers > 0 || rw->upgrader != NULL)
+    {
+      uint64_t start = rw->stat != NULL ? timer_ns () : 0;
+
+      /* rwlock_grant() makes us the writer before waking us. */
+      list_push_back (&rw->write_waiters, &cur->elem);
+      thread_block ();
+      if (rw->stat != NULL)
+        {
+          rw->acquired_ns = timer_ns ();
+          lockstat_acquired (rw->stat, true, rw->acquired_ns - start);
+        }
+    }
+  else
+    {
+      rw->writer = cur;
+      if (rw->stat != NULL)
+        {
+          rw->acquired_ns = timer_ns ();
+          lockstat_acquired (rw->stat, false, 0);
+        }
+    }
+  intr_set_level (old_level);
+}
+
+/* Tries to acquire write access to RW without sleeping.  Returns
+   true if successful, false on failure. */
+bool
+rwlock_try_acquire_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  success = (rw->writer == NULL && rw->readers == 0
+             && rw->upgrader == NULL);
+  if (success)
+    {
+      rw->writer = thread_current ();
+      if (rw->stat != NULL)
+        {
+          rw->acquired_ns = timer_ns ();
+          lockstat_acquired (rw->stat, false, 0);
+        }
+    }
+  intr_set_level (old_level);
+  return success;
+}
+
+/* Releases write access to RW, which the current thread must
+   hold. */
+void
+rwlock_release_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  old_level = intr_disable ();
+  if (rw->stat != NULL)
+    rw->stat->hold_ns += timer_ns () - rw->acquired_ns;
+  rw->writer = NULL;
+  rwlock_grant (rw);
+  intr_set_level (old_level);
+
+  thread_check_preemption ();
+}
+
+/* Atomically converts the current thread's write access to RW
+   into read access.  Other waiting readers are admitted too,
+   unless a writer is waiting. */
+void
+rwlock_downgrade (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  old_level = intr_disable ();
+  if (rw->stat != NULL)
+    rw->stat->hold_ns += timer_ns () - rw->acquired_ns;
+  rw->writer = NULL;
+  rw->readers = 1;
+  thread_current ()->rwlock_reads++;
+  rwlock_grant (rw);
+  intr_set_level (old_level);
+
+  thread_check_preemption ();
+}
+
+/* Converts the current thread's read access to RW into write
+   access, sleeping until every other reader has released it.
+   Returns true if successful.  Only one reader may be upgrading
+   at a time, since two would wait for each other forever; if
+   another thread is already upgrading, returns false without
+   sleeping and the current thread keeps its read access.  The
+   caller must then release RW and acquire it for writing,
+   rechecking whatever it observed while reading.
+
+   Waits ahead of any writers already queued.  This function may
+   sleep, so it must not be called within an interrupt
+   handler. */
+bool
+rwlock_upgrade (struct rwlock *rw) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  ASSERT (cur->rwlock_reads > 0);
+  if (rw->upgrader != NULL)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+
+  if (rw->readers == 1)
+    {
+      rw->readers = 0;
+      rw->writer = cur;
+    }
+  else
+    {
+      /* rwlock_grant() makes us the writer before waking us. */
+      rw->upgrader = cur;
+      thread_block ();
+    }
+  if (rw->stat != NULL)
+    rw->acquired_ns = timer_ns ();
+  cur->rwlock_reads--;
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* Hands RW to whichever waiters may now have it, after its state
+   has changed.  Ownership is transferred before the waiters are
+   woken, so they need not recheck anything.  Interrupts must be
+   off. */
+static void
+rwlock_grant (struct rwlock *rw) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (rw->writer != NULL)
+    return;
+
+  /* A pending upgrade goes first, once it is the last reader. */
+  if (rw->upgrader != NULL)
+    {
+      if (rw->readers == 1)
+        {
+          rw->readers = 0;
+          rw->writer = rw->upgrader;
+          rw->upgrader = NULL;
+          thread_unblock (rw->writer);
+        }
+      return;
+    }
+
+  if (!list_empty (&rw->write_waiters))
+    {
+      struct thread *w;
+
+      if (rw->readers > 0)
+        return;
+      w = list_entry (list_max (&rw->write_waiters,
+                                thread_priority_less, NULL),
+                      struct thread, elem);
+      if (list_empty (&rw->read_waiters)
+          || w->priority >= list_entry (list_max (&rw->read_waiters,
+                                                  thread_priority_less,
+                                                  NULL),
+                                        struct thread, elem)->priority)
+        {
+          list_remove (&w->elem);
+          rw->writer = w;
+          thread_unblock (w);
+          return;
+        }
+    }
+
+  /* Admit every waiting reader. */
+  while (!list_empty (&rw->read_waiters))
+    {
+      struct list_elem *e = list_pop_front (&rw->read_waiters);
+      rw->readers++;
+      thread_unblock (list_entry (e, struct thread, elem));
+    }
+}
+
+/* Returns the statistics entry for NAME, creating it if
+   necessary, or a null pointer if the table is full. */
+static struct lockstat *
+lockstat_register (const char *name) 
+{
+  struct lockstat *s = NULL;
+  enum intr_level old_level;
+  int i;
+
+  ASSERT (name != NULL);
+
+  old_level = intr_disable ();
+  for (i = 0; i < lockstat_cnt; i++)
+    if (!strcmp (lockstats[i].name, name))
+      {
+        s = &lockstats[i];
+        break;
+      }
+  if (s == NULL && lockstat_cnt < LOCKSTAT_MAX)
+    {
+      s = &lockstats[lockstat_cnt++];
+      strlcpy (s->name, name, sizeof s->name);
+    }
+  intr_set_level (old_level);
+
+  return s;
+}
+
+/* Records an acquisition in S that waited WAIT_NS nanoseconds,
+   having found the object unavailable if CONTENDED is true.
+   Interrupts must be off. */
+static void
+lockstat_acquired (struct lockstat *s, bool contended, uint64_t wait_ns) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  s->acquisitions++;
+  if (contended)
+    {
+      s->contentions++;
+      s->wait_ns += wait_ns;
+      if (wait_ns > s->max_wait_ns)
+        s->max_wait_ns = wait_ns;
+    }
+}
+
+/* Copies entry IDX of the lock statistics into *STAT.  Returns
+   false if there is no such entry. */
+bool
+lockstat_get (int idx, struct lockstat *stat) 
+{
+  enum intr_level old_level;
+  bool found;
+
+  old_level = intr_disable ();
+  found = idx >= 0 && idx < lockstat_cnt;
+  if (found)
+    *stat = lockstats[idx];
+  intr_set_level (old_level);
+
+  return found;
+}
+
+/* Prints lock statistics, most total waiting time first. */
+void
+lockstat_print (void) 
+{
+  static struct lockstat stats[LOCKSTAT_MAX];
+  int cnt, i, j;
+
+  for (cnt = 0; lockstat_get (cnt, &stats[cnt]); cnt++)
+    continue;
+
+  /* Insertion sort by descending wait time. */
+  for (i = 1; i < cnt; i++)
+    {
+      struct lockstat s = stats[i];
+      for (j = i; j > 0 && stats[j - 1].wait_ns < s.wait_ns; j--)
+        stats[j] = stats[j - 1];
+      stats[j] = s;
+    }
+
+  printf ("Locks: %-15s %10s %10s %14s %14s %14s\n", "name", "acquired",
+          "contended", "wait ns", "max wait ns", "hold ns");
+  for (i = 0; i < cnt; i++)
+    printf ("       %-15s %10"PRIu64" %10"PRIu64" %14"PRIu64" %14"PRIu64
+            " %14"PRIu64"\n",
+            stats[i].name, stats[i].acquisitions, stats[i].contentions,
+            stats[i].wait_ns, stats[i].max_wait_ns, stats[i].hold_ns);
+}
@@ -2,16 +2,20 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <lockstat.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
     struct list waiters;        /* List of waiting threads. */
+    struct lockstat *stat;      /* Contention statistics, or null. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
+void sema_set_name (struct semaphore *, const char *name);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
@@ -20,11 +24,16 @@ void sema_self_test (void);
 /* Lock. */
 struct lock 
   {
-    struct thread *holder;      /* Thread holding lock (for debugging). */
+    struct thread *holder;      /* Thread holding lock. */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct list_elem elem;      /* Element in holder's `locks' list. */
+    int max_priority;           /* Highest priority donated by waiters. */
+    struct lockstat *stat;      /* Contention statistics, or null. */
+    uint64_t acquired_ns;       /* timer_ns() when last acquired. */
   };
 
 void lock_init (struct lock *);
+void lock_set_name (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -41,6 +50,34 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock 
+  {
+    int readers;                /* Number of threads with read access. */
+    struct thread *writer;      /* Thread with write access, or null. */
+    struct thread *upgrader;    /* Reader waiting to upgrade, or null. */
+    struct list read_waiters;   /* Threads waiting for read access. */
+    struct list write_waiters;  /* Threads waiting for write access. */
+    struct lockstat *stat;      /* Contention statistics, or null. */
+    uint64_t acquired_ns;       /* timer_ns() when writer acquired. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_set_name (struct rwlock *, const char *name);
+void rwlock_acquire_read (struct rwlock *);
+bool rwlock_try_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+bool rwlock_try_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+void rwlock_downgrade (struct rwlock *);
+bool rwlock_upgrade (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Lock contention statistics. */
+bool lockstat_get (int idx, struct lockstat *);
+void lockstat_print (void);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -1,9 +1,12 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
+#include "threads/fixed-point.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
@@ -11,6 +14,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/syscall.h"
@@ -21,13 +25,45 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue: processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level, plus a bitmap with
+   bit P set whenever ready_lists[P] is nonempty, so that the
+   highest-priority ready thread can be found with a single
+   bit scan instead of a walk over every ready thread. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+#define READY_WORD_BITS 32
+#define READY_WORD_CNT ((PRI_CNT + READY_WORD_BITS - 1) / READY_WORD_BITS)
+static struct list ready_lists[PRI_CNT];
+static uint32_t ready_bitmap[READY_WORD_CNT];
+static int ready_cnt;           /* # of threads in the run queues. */
+
+/* Earliest-deadline-first scheduling class.  A thread admitted by
+   thread_set_edf() is entitled to `edf_budget' ticks of CPU time
+   in each period of `edf_period' ticks.  While it has budget left
+   in its current period, it sits in edf_ready instead of
+   ready_lists and runs ahead of every thread of the normal
+   class, earliest deadline (end of period) first.  Once it has
+   used its budget, it falls back to the normal class at its
+   usual priority until its next period begins.
+
+   Admission control keeps the total utilization, the sum of
+   budget / period over all EDF threads, at most EDF_UTIL_MAX_PCT
+   percent, which both guarantees that every EDF thread meets its
+   deadlines and leaves time for the normal class.  Accessed with
+   interrupts off. */
+#define EDF_UTIL_MAX_PCT 90
+static struct list edf_ready;   /* Ready EDF threads with budget. */
+static struct list edf_threads; /* All EDF threads. */
+static fixed_point_t edf_util;  /* Total utilization. */
 
 /* List of all processes.  Processes are added to this list
-   when they are first scheduled and removed when they exit. */
+   when they are first scheduled and removed when they exit.
+   Accessed with interrupts off.  Removals also hold
+   all_list_lock, so that a thread holding it may walk the list
+   with interrupts enabled between elements. */
 static struct list all_list;
+static struct lock all_list_lock;
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -50,6 +86,12 @@ struct kernel_thread_frame
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
+static long long voluntary_switches;   /* # of switches due to blocking. */
+static long long involuntary_switches; /* # of switches due to preemption. */
+static uint32_t latency_hist[SCHED_LATENCY_BUCKETS];
+                                /* Histogram of time spent ready before
+                                   running, in timer_cycles(); see
+                                   <sched-stats.h>. */
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
@@ -60,6 +102,20 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* 4.4BSD scheduler. */
+#define NICE_MIN -20            /* Lowest nice value. */
+#define NICE_MAX 20             /* Highest nice value. */
+#define PRI_UPDATE_TICKS 4      /* Recompute priority this often. */
+static fixed_point_t load_avg;  /* Estimated # of threads ready to run
+                                   over the last minute. */
+
+/* Threads charged a tick of recent_cpu since the last multiple
+   of PRI_UPDATE_TICKS, whose priorities are due to be recomputed
+   then.  At most one thread is charged per tick.  Protected by
+   disabling interrupts. */
+static struct thread *mlfqs_charged[PRI_UPDATE_TICKS];
+static int mlfqs_charged_cnt;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -69,7 +125,30 @@ static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
+static void account_switch (struct thread *cur, struct thread *next);
+static int latency_bucket (uint64_t);
+static void latency_hist_ns (uint32_t hist[SCHED_LATENCY_BUCKETS]);
 void thread_schedule_tail (struct thread *prev);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static struct thread *ready_pop (void);
+static int ready_max_priority (void);
+static bool ready_preempts (const struct thread *);
+static bool edf_runnable (const struct thread *);
+static bool edf_replenish (struct thread *, int64_t now);
+static bool edf_tick (struct thread *);
+static void edf_leave (struct thread *);
+/* Once-per-second recalculation of every thread's recent_cpu,
+   deferred from the timer interrupt to the worker thread. */
+static struct work mlfqs_decay_work;
+
+static bool mlfqs_exempt (const struct thread *);
+static void mlfqs_tick (struct thread *);
+static work_func mlfqs_decay_all;
+static void mlfqs_decay (struct thread *, void *coeff);
+static int mlfqs_priority (const struct thread *);
+static void mlfqs_update_priority (struct thread *);
+static void mlfqs_forget (struct thread *);
 static tid_t allocate_tid (void);
 
 /* Initializes the threading system by transforming the code
@@ -88,10 +167,19 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  lock_set_name (&tid_lock, "tid_lock");
+  lock_init (&all_list_lock);
+  work_init (&mlfqs_decay_work, mlfqs_decay_all, NULL);
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_lists[i]);
+  list_init (&edf_ready);
+  list_init (&edf_threads);
+  edf_util = fix_int (0);
   list_init (&all_list);
 
   /* Set up a thread structure for the running thread. */
@@ -135,17 +223,265 @@ thread_tick (void)
   else
     kernel_ticks++;
 
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+
+  /* Charge EDF budget and start new EDF periods. */
+  if (!list_empty (&edf_threads) && edf_tick (t))
+    intr_yield_on_return ();
+
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
 }
 
+/* Returns true if T keeps a fixed priority under the 4.4BSD
+   scheduler and is left out of its statistics: the idle thread,
+   and the worker thread that runs the scheduler's own deferred
+   work. */
+static bool
+mlfqs_exempt (const struct thread *t) 
+{
+  return t == idle_thread || workqueue_is_worker (t);
+}
+
+/* Updates the 4.4BSD scheduler's statistics for a timer tick
+   during which CUR was running.  CUR's recent_cpu grows every
+   tick, so every PRI_UPDATE_TICKS ticks the priority of each
+   thread charged since the last time is recomputed, whether or
+   not it is still running.  Once per second the load average is
+   recalculated here,
+   and decaying every thread's recent_cpu is handed off to the
+   worker thread, since it takes time proportional to the number
+   of threads.  Runs in an external interrupt context. */
+static void
+mlfqs_tick (struct thread *cur) 
+{
+  int64_t now = timer_ticks ();
+  bool exempt = mlfqs_exempt (cur);
+
+  if (!exempt) 
+    {
+      cur->recent_cpu = fix_add_int (cur->recent_cpu, 1);
+      if (mlfqs_charged_cnt == 0
+          || mlfqs_charged[mlfqs_charged_cnt - 1] != cur) 
+        {
+          int i;
+
+          for (i = 0; i < mlfqs_charged_cnt; i++)
+            if (mlfqs_charged[i] == cur)
+              break;
+          if (i == mlfqs_charged_cnt)
+            mlfqs_charged[mlfqs_charged_cnt++] = cur;
+        }
+    }
+
+  if (now % TIMER_FREQ == 0)
+    {
+      int ready_threads = ready_cnt + !exempt;
+
+      load_avg = fix_add (fix_mul (fix_frac (59, 60), load_avg),
+                          fix_scale (fix_frac (1, 60), ready_threads));
+      work_schedule (&mlfqs_decay_work);
+    }
+  /* Ticks skipped while idle can jump past a multiple of
+     PRI_UPDATE_TICKS, so also recompute when the array fills. */
+  if (now % PRI_UPDATE_TICKS == 0 || mlfqs_charged_cnt == PRI_UPDATE_TICKS) 
+    {
+      int i;
+
+      for (i = 0; i < mlfqs_charged_cnt; i++)
+        mlfqs_update_priority (mlfqs_charged[i]);
+      mlfqs_charged_cnt = 0;
+    }
+}
+
+/* Drops T, which is exiting, from the threads whose priorities
+   are due to be recomputed.  Interrupts must be off. */
+static void
+mlfqs_forget (struct thread *t) 
+{
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (i = 0; i < mlfqs_charged_cnt; i++)
+    if (mlfqs_charged[i] == t) 
+      {
+        mlfqs_charged[i] = mlfqs_charged[--mlfqs_charged_cnt];
+        break;
+      }
+}
+
+/* Decays every thread's recent_cpu according to the current load
+   average.  Runs in the worker thread.  Interrupts are turned
+   off for only one thread at a time; holding all_list_lock keeps
+   our place in all_list from being removed in between. */
+static void
+mlfqs_decay_all (void *aux UNUSED) 
+{
+  fixed_point_t twice_load, coeff;
+  enum intr_level old_level;
+  struct list_elem *e;
+
+  lock_acquire (&all_list_lock);
+  old_level = intr_disable ();
+  twice_load = fix_scale (load_avg, 2);
+  coeff = fix_div (twice_load, fix_add_int (twice_load, 1));
+  e = list_begin (&all_list);
+  while (e != list_end (&all_list))
+    {
+      mlfqs_decay (list_entry (e, struct thread, allelem), &coeff);
+      e = list_next (e);
+      intr_set_level (old_level);
+      old_level = intr_disable ();
+    }
+  intr_set_level (old_level);
+  lock_release (&all_list_lock);
+}
+
+/* Decays T's recent_cpu by *COEFF_ and adds its nice value, then
+   recomputes its priority if anything changed.  Interrupts must
+   be off. */
+static void
+mlfqs_decay (struct thread *t, void *coeff_) 
+{
+  const fixed_point_t *coeff = coeff_;
+  fixed_point_t recent_cpu;
+
+  if (mlfqs_exempt (t))
+    return;
+
+  recent_cpu = fix_add_int (fix_mul (*coeff, t->recent_cpu), t->nice);
+  if (fix_compare (recent_cpu, t->recent_cpu) == 0)
+    return;
+  t->recent_cpu = recent_cpu;
+  mlfqs_update_priority (t);
+}
+
+/* Returns the 4.4BSD priority for T, computed from its
+   recent_cpu and nice values. */
+static int
+mlfqs_priority (const struct thread *t) 
+{
+  int priority = (PRI_MAX - fix_trunc (fix_unscale (t->recent_cpu, 4))
+                  - t->nice * 2);
+
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  return priority;
+}
+
+/* Recomputes T's priority from its recent_cpu and nice values,
+   moving T to a different run queue if necessary.  Interrupts
+   must be off. */
+static void
+mlfqs_update_priority (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->base_priority = mlfqs_priority (t);
+  thread_set_effective_priority (t, t->base_priority);
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
 {
+  uint32_t hist[SCHED_LATENCY_BUCKETS];
+  enum intr_level old_level;
+  int i;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Scheduler: %lld voluntary switches, %lld involuntary switches\n",
+          voluntary_switches, involuntary_switches);
+  old_level = intr_disable ();
+  latency_hist_ns (hist);
+  intr_set_level (old_level);
+  printf ("Scheduling latency (ns):");
+  for (i = 0; i < SCHED_LATENCY_BUCKETS; i++)
+    if (hist[i] != 0)
+      {
+        if (i == 0)
+          printf (" [0]=%"PRIu32, hist[i]);
+        else
+          printf (" [%"PRIu64",%"PRIu64")=%"PRIu32, (uint64_t) 1 << (i - 1),
+                  (uint64_t) 1 << i, hist[i]);
+      }
+  printf ("\n");
+}
+
+/* Copies the scheduler counters for the thread with the given
+   TID, or for the running thread if TID is 0, into *STATS,
+   along with the system-wide scheduling latency histogram.
+   Returns false if there is no such thread. */
+bool
+thread_get_sched_stats (tid_t tid, struct sched_stats *stats) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  struct list_elem *e;
+  bool found = false;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      if (tid == 0 ? t == cur : t->tid == tid)
+        {
+          stats->thread = t->sched_stats;
+          stats->thread.run_ns = timer_cycles_to_ns (t->run_cycles);
+          stats->thread.ready_ns = timer_cycles_to_ns (t->ready_cycles);
+          stats->thread.blocked_ns = timer_cycles_to_ns (t->blocked_cycles);
+          found = true;
+          break;
+        }
+    }
+  latency_hist_ns (stats->latency_hist);
+  intr_set_level (old_level);
+
+  return found;
+}
+
+/* Returns the latency histogram bucket for a latency of N, in
+   any unit. */
+static int
+latency_bucket (uint64_t n) 
+{
+  int bucket;
+
+  if (n == 0)
+    bucket = 0;
+  else if (n > UINT32_MAX)
+    bucket = SCHED_LATENCY_BUCKETS - 1;
+  else
+    bucket = 32 - __builtin_clz ((uint32_t) n);
+  if (bucket >= SCHED_LATENCY_BUCKETS)
+    bucket = SCHED_LATENCY_BUCKETS - 1;
+  return bucket;
+}
+
+/* Regroups the latency histogram, which is kept in cycles, by
+   nanoseconds into HIST.  Each cycle bucket is counted in the
+   bucket of its lower bound.  Interrupts must be off. */
+static void
+latency_hist_ns (uint32_t hist[SCHED_LATENCY_BUCKETS]) 
+{
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  memset (hist, 0, sizeof latency_hist);
+  for (i = 0; i < SCHED_LATENCY_BUCKETS; i++)
+    if (latency_hist[i] != 0)
+      {
+        uint64_t low = i == 0 ? 0 : timer_cycles_to_ns ((uint64_t) 1 << (i - 1));
+        hist[latency_bucket (low)] += latency_hist[i];
+      }
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -160,9 +496,8 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread has a higher priority than the running
+   thread, the running thread yields to it immediately. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
@@ -176,7 +511,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = palloc_get_recycled_page ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -201,6 +536,7 @@ thread_create (const char *name, int priority,
 
   /* Add to run queue. */
   thread_unblock (t);
+  thread_check_preemption ();
 
   return tid;
 }
@@ -228,18 +564,23 @@ thread_block (void)
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
-   update other data. */
+   update other data.  Call thread_check_preemption() afterward
+   to let a higher-priority T run. */
 void
 thread_unblock (struct thread *t) 
 {
   enum intr_level old_level;
+  uint64_t now;
 
   ASSERT (is_thread (t));
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  ready_push (t);
   t->status = THREAD_READY;
+  now = timer_cycles ();
+  t->blocked_cycles += now - t->status_cycles;
+  t->status_cycles = now;
   intr_set_level (old_level);
 }
 
@@ -281,18 +622,27 @@ thread_tid (void)
 void
 thread_exit (void) 
 {
+  enum intr_level old_level;
+
   ASSERT (!intr_context ());
 
 #ifdef USERPROG
   process_exit ();
-#endif
   syscall_exit ();
+#endif
   
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
-  intr_disable ();
+  lock_acquire (&all_list_lock);
+  old_level = intr_disable ();
   list_remove (&thread_current()->allelem);
+  edf_leave (thread_current ());
+  intr_set_level (old_level);
+  lock_release (&all_list_lock);
+
+  intr_disable ();
+  mlfqs_forget (thread_current ());
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -310,12 +660,31 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+    ready_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Yields the CPU if some ready thread has a higher priority than
+   the running thread.  Within an external interrupt handler,
+   arranges for the yield to happen when the interrupt returns
+   instead. */
+void
+thread_check_preemption (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  bool preempt = ready_preempts (thread_current ());
+  intr_set_level (old_level);
+
+  if (!preempt)
+    return;
+  if (intr_context ())
+    intr_yield_on_return ();
+  else
+    thread_yield ();
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -333,49 +702,189 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY.  Its
+   effective priority never drops below what other threads are
+   donating to it.  Yields if the current thread no longer has
+   the highest priority.
+
+   Ignored under the 4.4BSD scheduler, which computes priorities
+   itself. */
 void
 thread_set_priority (int new_priority) 
 {
-  thread_current ()->priority = new_priority;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  cur->base_priority = new_priority;
+  thread_update_priority (cur);
+  intr_set_level (old_level);
+
+  thread_check_preemption ();
+}
+
+/* Sets T's effective priority to PRIORITY, moving T to the
+   matching run queue if it is ready.  Used for priority
+   donation.  Interrupts must be off. */
+void
+thread_set_effective_priority (struct thread *t, int priority) 
+{
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (t->priority == priority)
+    return;
+
+  if (t->status == THREAD_READY)
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
+  else
+    t->priority = priority;
+}
+
+/* Recomputes T's effective priority as the maximum of its base
+   priority and the priorities donated through each lock that T
+   holds.  Interrupts must be off. */
+void
+thread_update_priority (struct thread *t) 
+{
+  int priority = t->base_priority;
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!thread_mlfqs)
+    for (e = list_begin (&t->locks); e != list_end (&t->locks);
+         e = list_next (e))
+      {
+        struct lock *lock = list_entry (e, struct lock, elem);
+        if (lock->max_priority > priority)
+          priority = lock->max_priority;
+      }
+  thread_set_effective_priority (t, priority);
+}
+
+/* Returns true if thread A has a lower effective priority than
+   thread B, false otherwise.  Suitable for list_max() over lists
+   linked through `elem', such as semaphore wait lists. */
+bool
+thread_priority_less (const struct list_elem *a, const struct list_elem *b,
+                      void *aux UNUSED) 
+{
+  return (list_entry (a, struct thread, elem)->priority
+          < list_entry (b, struct thread, elem)->priority);
 }
 
-/* Returns the current thread's priority. */
+/* Returns the current thread's effective priority. */
 int
 thread_get_priority (void) 
 {
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, clamped to
+   [NICE_MIN, NICE_MAX], and recomputes its priority.  Yields if
+   the current thread no longer has the highest priority. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  if (nice < NICE_MIN)
+    nice = NICE_MIN;
+  else if (nice > NICE_MAX)
+    nice = NICE_MAX;
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_priority (cur);
+  intr_set_level (old_level);
+
+  thread_check_preemption ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fix_round (fix_scale (load_avg, 100));
+  intr_set_level (old_level);
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100 = fix_round (fix_scale (thread_current ()->recent_cpu,
+                                             100));
+  intr_set_level (old_level);
+  return recent_cpu_100;
+}
+
+/* Moves the current thread into the earliest-deadline-first
+   class, with BUDGET ticks of CPU time guaranteed in every period
+   of PERIOD ticks, starting now.  A PERIOD of 0 moves it back to
+   the normal class.  Returns false, leaving the thread as it
+   was, if the request is malformed or if admitting it would push
+   total EDF utilization above EDF_UTIL_MAX_PCT percent. */
+bool
+thread_set_edf (int period, int budget) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  fixed_point_t util;
+
+  if (period < 0 || (period > 0 && (budget <= 0 || budget > period)))
+    return false;
+
+  old_level = intr_disable ();
+  util = edf_util;
+  if (cur->edf_period > 0)
+    util = fix_sub (util, fix_frac (cur->edf_budget, cur->edf_period));
+  if (period > 0) 
+    {
+      util = fix_add (util, fix_frac (budget, period));
+      if (fix_compare (util, fix_frac (EDF_UTIL_MAX_PCT, 100)) > 0) 
+        {
+          intr_set_level (old_level);
+          return false;
+        }
+    }
+
+  if (cur->edf_period == 0 && period > 0)
+    list_push_back (&edf_threads, &cur->edfelem);
+  else if (cur->edf_period > 0 && period == 0)
+    list_remove (&cur->edfelem);
+  edf_util = util;
+  cur->edf_period = period;
+  cur->edf_budget = budget;
+  cur->edf_used = 0;
+  cur->edf_deadline = timer_ticks () + period;
+  intr_set_level (old_level);
+
+  thread_check_preemption ();
+  return true;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -400,6 +909,18 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing else is ready, so zero recycled pages while we
+         wait.  Any thread that becomes ready preempts us. */
+      intr_enable ();
+      while (ready_cnt == 0 && palloc_scrub_page ())
+        continue;
+      intr_disable ();
+      if (ready_cnt > 0)
+        continue;
+
+      timer_idle_enter ();
+      irqsoff_mark_enabled (idle);
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -463,7 +984,22 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  t->status_cycles = timer_cycles ();
+  if (thread_mlfqs)
+    {
+      /* Inherit the creating thread's scheduling history.  The
+         initial thread starts from zero. */
+      if (t != initial_thread)
+        {
+          struct thread *parent = thread_current ();
+          t->nice = parent->nice;
+          t->recent_cpu = parent->recent_cpu;
+        }
+      t->priority = t->base_priority = mlfqs_priority (t);
+    }
+  list_init (&t->locks);
+  t->waiting_lock = NULL;
   list_init (&t->children);
   t->wait_status = NULL;
   list_init (&t->fds);
@@ -496,10 +1032,197 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+  struct thread *t = ready_pop ();
+  return t != NULL ? t : idle_thread;
+}
+
+/* Returns true if EDF thread A's deadline is earlier than B's. */
+static bool
+deadline_less (const struct list_elem *a, const struct list_elem *b,
+               void *aux UNUSED) 
+{
+  return (list_entry (a, struct thread, elem)->edf_deadline
+          < list_entry (b, struct thread, elem)->edf_deadline);
+}
+
+/* Adds T to the run queue: the EDF run queue, in deadline order,
+   if T is an EDF thread with budget left, otherwise the tail of
+   the run queue for its priority. */
+static void
+ready_push (struct thread *t) 
+{
+  int pri = t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= pri && pri <= PRI_MAX);
+
+  if (t->edf_period > 0)
+    {
+      edf_replenish (t, timer_ticks ());
+      if (edf_runnable (t))
+        {
+          list_insert_ordered (&edf_ready, &t->elem, deadline_less, NULL);
+          t->edf_queued = true;
+          ready_cnt++;
+          return;
+        }
+    }
+
+  list_push_back (&ready_lists[pri - PRI_MIN], &t->elem);
+  ready_cnt++;
+  ready_bitmap[(pri - PRI_MIN) / READY_WORD_BITS]
+    |= 1u << ((pri - PRI_MIN) % READY_WORD_BITS);
+}
+
+/* Removes ready thread T from its run queue. */
+static void
+ready_remove (struct thread *t) 
+{
+  int pri = t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  ready_cnt--;
+  if (t->edf_queued)
+    {
+      t->edf_queued = false;
+      return;
+    }
+  if (list_empty (&ready_lists[pri - PRI_MIN]))
+    ready_bitmap[(pri - PRI_MIN) / READY_WORD_BITS]
+      &= ~(1u << ((pri - PRI_MIN) % READY_WORD_BITS));
+}
+
+/* Returns the highest priority of any ready thread, or
+   PRI_MIN - 1 if the run queue is empty. */
+static int
+ready_max_priority (void) 
+{
+  int word;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (word = READY_WORD_CNT - 1; word >= 0; word--)
+    if (ready_bitmap[word] != 0)
+      return (PRI_MIN + word * READY_WORD_BITS
+              + (READY_WORD_BITS - 1 - __builtin_clz (ready_bitmap[word])));
+  return PRI_MIN - 1;
+}
+
+/* Returns true if some ready thread should run in place of CUR,
+   the running thread: an EDF thread with an earlier deadline, or
+   if CUR is not running as an EDF thread, any EDF thread or a
+   thread of higher priority. */
+static bool
+ready_preempts (const struct thread *cur) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!list_empty (&edf_ready))
+    {
+      struct thread *t = list_entry (list_front (&edf_ready),
+                                     struct thread, elem);
+      return !edf_runnable (cur) || t->edf_deadline < cur->edf_deadline;
+    }
+  return !edf_runnable (cur) && ready_max_priority () > cur->priority;
+}
+
+/* Removes and returns the EDF thread with the earliest deadline,
+   if any, otherwise the first thread in the highest-priority
+   nonempty run queue, or a null pointer if every run queue is
+   empty. */
+static struct thread *
+ready_pop (void) 
+{
+  int pri;
+  struct list *queue;
+  struct thread *t;
+
+  if (!list_empty (&edf_ready))
+    {
+      t = list_entry (list_pop_front (&edf_ready), struct thread, elem);
+      t->edf_queued = false;
+      ready_cnt--;
+      return t;
+    }
+
+  pri = ready_max_priority ();
+  if (pri < PRI_MIN)
+    return NULL;
+
+  queue = &ready_lists[pri - PRI_MIN];
+  t = list_entry (list_pop_front (queue), struct thread, elem);
+  ready_cnt--;
+  if (list_empty (queue))
+    ready_bitmap[(pri - PRI_MIN) / READY_WORD_BITS]
+      &= ~(1u << ((pri - PRI_MIN) % READY_WORD_BITS));
+  return t;
+}
+
+/* Returns true if T is an EDF thread with budget left in its
+   current period. */
+static bool
+edf_runnable (const struct thread *t) 
+{
+  return t->edf_period > 0 && t->edf_used < t->edf_budget;
+}
+
+/* If EDF thread T's period has ended by tick NOW, starts its
+   current period with a full budget and returns true.  Otherwise
+   returns false. */
+static bool
+edf_replenish (struct thread *t, int64_t now) 
+{
+  if (now < t->edf_deadline)
+    return false;
+  t->edf_deadline += ((now - t->edf_deadline) / t->edf_period + 1)
+                     * t->edf_period;
+  t->edf_used = 0;
+  return true;
+}
+
+/* Charges a tick to CUR's EDF budget and replenishes every EDF
+   thread whose period has ended, moving ready ones back into the
+   EDF run queue.  Returns true if CUR should now be preempted.
+   Runs in the timer interrupt. */
+static bool
+edf_tick (struct thread *cur) 
+{
+  int64_t now = timer_ticks ();
+  struct list_elem *e;
+
+  if (edf_runnable (cur))
+    cur->edf_used++;
+
+  for (e = list_begin (&edf_threads); e != list_end (&edf_threads);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, edfelem);
+      if (edf_replenish (t, now) && t->status == THREAD_READY
+          && !t->edf_queued)
+        {
+          ready_remove (t);
+          ready_push (t);
+        }
+    }
+
+  return ready_preempts (cur);
+}
+
+/* Removes T from the EDF class, if it is in it.  Interrupts must
+   be off. */
+static void
+edf_leave (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->edf_period == 0)
+    return;
+  edf_util = fix_sub (edf_util, fix_frac (t->edf_budget, t->edf_period));
+  list_remove (&t->edfelem);
+  t->edf_period = 0;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -540,11 +1263,12 @@ thread_schedule_tail (struct thread *prev)
      thread.  This must happen late so that thread_exit() doesn't
      pull out the rug under itself.  (We don't free
      initial_thread because its memory was not obtained via
-     palloc().) */
+     palloc().)  The page goes to the recycled page cache, to be
+     scrubbed by the idle thread and reused by thread_create(). */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      palloc_recycle_page (prev);
     }
 }
 
@@ -566,11 +1290,48 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  account_switch (cur, next);
   if (cur != next)
     prev = switch_threads (cur, next);
   thread_schedule_tail (prev);
 }
 
+/* Updates scheduler statistics for a switch from CUR, whose
+   status has already been changed from THREAD_RUNNING, to NEXT,
+   which may be the same thread.  Times are kept in raw
+   timer_cycles(), which costs no 64-bit division here, and
+   converted to nanoseconds only when reported. */
+static void
+account_switch (struct thread *cur, struct thread *next) 
+{
+  uint64_t now = timer_cycles ();
+
+  cur->run_cycles += now - cur->status_cycles;
+  cur->status_cycles = now;
+  if (cur == next)
+    return;
+
+  if (cur->status == THREAD_READY)
+    {
+      cur->sched_stats.involuntary_switches++;
+      involuntary_switches++;
+    }
+  else if (cur->status == THREAD_BLOCKED)
+    {
+      cur->sched_stats.voluntary_switches++;
+      voluntary_switches++;
+    }
+
+  if (next != idle_thread)
+    {
+      uint64_t latency = now - next->status_cycles;
+
+      latency_hist[latency_bucket (latency)]++;
+      next->ready_cycles += latency;
+    }
+  next->status_cycles = now;
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) 
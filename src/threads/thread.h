@@ -3,7 +3,9 @@
 
 #include <debug.h>
 #include <list.h>
+#include <sched-stats.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
 #include "threads/synch.h"
 
 #ifdef VM
@@ -81,10 +83,11 @@ typedef int tid_t;
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
    the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   semaphore wait list (synch.c) or the sleep list (timer.c).  It
+   can be used these ways only because they are mutually
+   exclusive: only a thread in the ready state is on the run
+   queue, whereas only a thread in the blocked state is on a
+   semaphore wait list or the sleep list. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -92,20 +95,51 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Effective priority. */
+    int base_priority;                  /* Priority before donation. */
     struct list_elem allelem;           /* List element for all threads list. */
+    int nice;                           /* Niceness, for 4.4BSD scheduler. */
+    fixed_point_t recent_cpu;           /* Recent CPU time, for 4.4BSD
+                                           scheduler. */
+    uint64_t status_cycles;             /* timer_cycles() at last status
+                                           change. */
+    uint64_t run_cycles;                /* Cycles spent running. */
+    uint64_t ready_cycles;              /* Cycles spent waiting to run. */
+    uint64_t blocked_cycles;            /* Cycles spent blocked. */
+    struct sched_thread_stats sched_stats; /* Scheduler statistics.  Its
+                                           times are filled in from the
+                                           cycle counts above only when
+                                           reported. */
+    int64_t edf_period;                 /* EDF period in ticks, 0 if none. */
+    int64_t edf_budget;                 /* EDF ticks of CPU per period. */
+    int64_t edf_deadline;               /* End of current EDF period. */
+    int64_t edf_used;                   /* Ticks used in current period. */
+    bool edf_queued;                    /* In the EDF run queue? */
+    struct list_elem edfelem;           /* List element for EDF threads. */
+
+    /* Shared between thread.c and synch.c. */
+    struct list locks;                  /* Locks held, for donation. */
+    struct lock *waiting_lock;          /* Lock being waited for. */
+
+    /* Owned by synch.c. */
+    int rwlock_reads;                   /* Read locks held, for debugging. */
 
     /* Owned by process.c. */
     struct wait_status *wait_status;    /* This process's completion status. */
     struct list children;               /* Completion status of children. */
 
-    /* Shared between thread.c and synch.c. */
+    /* Shared between thread.c, synch.c and timer.c. */
     struct list_elem elem;              /* List element. */
-    
+
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* Tick at which to wake from
+                                           timer_sleep(). */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    struct process *process;            /* Process this thread is part of. */
+    struct uthread *uthread;            /* Null for a process's main thread. */
 
     uint8_t *current_esp;               /* The current value of the user program’s stack pointer.
                                            A page fault might occur in the kernel, so we might
@@ -150,6 +184,7 @@ void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+bool thread_get_sched_stats (tid_t, struct sched_stats *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -163,6 +198,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_check_preemption (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -170,10 +206,16 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_set_effective_priority (struct thread *, int);
+void thread_update_priority (struct thread *);
+bool thread_priority_less (const struct list_elem *,
+                           const struct list_elem *, void *aux);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
+
+bool thread_set_edf (int period, int budget);
 int thread_get_load_avg (void);
 
 #endif /* threads/thread.h */
@@ -0,0 +1,147 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Work items waiting to run.  Protected by disabling
+   interrupts, since items are scheduled from interrupt
+   handlers.  Statically initialized, because the timer may
+   schedule work before workqueue_init() runs. */
+static struct list pending_list = LIST_INITIALIZER (pending_list);
+
+/* Thread that runs work items, or null before workqueue_init()
+   has started it. */
+static struct thread *worker;
+
+/* True while the worker is blocked waiting for work, as opposed
+   to blocked inside a work function, e.g. on a lock.  Protected
+   by disabling interrupts. */
+static bool worker_idle;
+
+/* Statistics. */
+static long long work_cnt;      /* # of work items run. */
+static long long batch_cnt;     /* # of times the worker woke up. */
+
+static thread_func worker_thread;
+
+/* Starts the worker thread.  Work scheduled before this is
+   called runs as soon as the worker starts. */
+void
+workqueue_init (void) 
+{
+  struct semaphore started;
+
+  sema_init (&started, 0);
+  thread_create ("worker", PRI_MAX, worker_thread, &started);
+  sema_down (&started);
+}
+
+/* Prints work queue statistics. */
+void
+workqueue_print_stats (void) 
+{
+  printf ("Work queue: %lld items in %lld batches\n", work_cnt, batch_cnt);
+}
+
+/* Returns true if T is the worker thread. */
+bool
+workqueue_is_worker (const struct thread *t) 
+{
+  return t == worker;
+}
+
+/* Initializes WORK to call FUNC with AUX when it runs. */
+void
+work_init (struct work *work, work_func *func, void *aux) 
+{
+  ASSERT (work != NULL);
+  ASSERT (func != NULL);
+
+  work->func = func;
+  work->aux = aux;
+  work->pending = false;
+}
+
+/* Schedules WORK to run in the worker thread.  Returns true if
+   it was queued, false if it was already pending, in which case
+   it still runs only once.  May be called from an interrupt
+   handler. */
+bool
+work_schedule (struct work *work) 
+{
+  enum intr_level old_level;
+  bool queued;
+
+  ASSERT (work != NULL);
+
+  old_level = intr_disable ();
+  queued = !work->pending;
+  if (queued)
+    {
+      work->pending = true;
+      list_push_back (&pending_list, &work->elem);
+      if (worker_idle) 
+        {
+          worker_idle = false;
+          thread_unblock (worker);
+        }
+    }
+  intr_set_level (old_level);
+
+  if (queued)
+    thread_check_preemption ();
+  return queued;
+}
+
+/* Runs work items as they are scheduled. */
+static void
+worker_thread (void *started_) 
+{
+  struct semaphore *started = started_;
+  struct thread *cur = thread_current ();
+
+  /* Under the 4.4BSD scheduler, thread_create() ignores the
+     priority we asked for.  Restore it; thread.c leaves the
+     worker's priority alone from here on. */
+  intr_disable ();
+  cur->base_priority = PRI_MAX;
+  thread_set_effective_priority (cur, PRI_MAX);
+  worker = cur;
+  intr_enable ();
+  sema_up (started);
+
+  for (;;) 
+    {
+      struct list batch;
+
+      /* Wait for work, then take everything that is pending. */
+      intr_disable ();
+      while (list_empty (&pending_list)) 
+        {
+          worker_idle = true;
+          thread_block ();
+        }
+      list_init (&batch);
+      while (!list_empty (&pending_list))
+        list_push_back (&batch, list_pop_front (&pending_list));
+      batch_cnt++;
+      intr_enable ();
+
+      while (!list_empty (&batch)) 
+        {
+          struct work *work = list_entry (list_pop_front (&batch),
+                                          struct work, elem);
+
+          /* Clear pending first, so that the item can be
+             rescheduled while it runs. */
+          intr_disable ();
+          work->pending = false;
+          intr_enable ();
+
+          work->func (work->aux);
+          work_cnt++;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+struct thread;
+
+/* Deferred work.
+
+   An interrupt handler that has more to do than it can afford
+   with interrupts off can instead schedule a work item, which a
+   dedicated kernel thread at PRI_MAX runs soon after the handler
+   returns.  Work functions run in an ordinary thread context,
+   with interrupts on, so they may acquire locks, but they should
+   not sleep for long because every other work item waits behind
+   them.
+
+   All work items pending when the worker thread wakes up are run
+   as one batch. */
+
+typedef void work_func (void *aux);
+
+/* A work item. */
+struct work 
+  {
+    struct list_elem elem;      /* Element in the pending list. */
+    work_func *func;            /* Function to run. */
+    void *aux;                  /* Argument to FUNC. */
+    bool pending;               /* True while queued. */
+  };
+
+void workqueue_init (void);
+void workqueue_print_stats (void);
+bool workqueue_is_worker (const struct thread *);
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_schedule (struct work *);
+
+#endif /* threads/workqueue.h */
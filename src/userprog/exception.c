@@ -7,6 +7,7 @@
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/process.h"
 #include "userprog/syscall.h"
 
 #ifdef VM
@@ -20,7 +21,6 @@ static long long page_fault_cnt;
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
-#define MAX_STACK_SIZE 0x1600000 // max stack size 16MB
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -192,11 +192,11 @@ page_fault (struct intr_frame *f)
    extending_stack = (fault_addr == f->esp - 4 || fault_addr == f->esp - 32);
    on_stack_frame = (esp <= fault_addr || extending_stack);
    is_user_stack_addr = (PHYS_BASE - MAX_STACK_SIZE <= fault_addr && fault_addr < PHYS_BASE);
-   if (on_stack_frame && is_user_stack_addr) {
+   if ((on_stack_frame && is_user_stack_addr) || process_is_thread_stack (fault_addr)) {
       // Faulted page is in user virtual address and does not exceed stack limit
       // Add new entry to supplemental page table if it does not exist.
-      if (supt_pt_has_entry (curr_thread->supt, fault_page) == false) {
-         supt_pt_install_zeropage (curr_thread->supt, fault_page);
+      if (!supt_pt_install_stack_page (curr_thread->supt, fault_page)) {
+         goto PAGE_FAULT_VIOLATED_ACCESS;
       }
    }
 
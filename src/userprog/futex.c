@@ -0,0 +1,189 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "userprog/uaccess.h"
+
+/* Futexes: user words that threads may sleep on.
+
+   A thread sleeps on a word only if the word still holds the
+   value that the thread expects, which it checks with the wait
+   queue locked.  A waker changes the word before waking, so a
+   wakeup can never slip in between the check and the sleep.
+
+   Wait queues are kept in a fixed hash table, keyed by process
+   and user virtual address.  Only the threads of one process
+   share memory, so this key names the same word as its frame
+   would, and unlike the frame it stays the same when the page is
+   evicted. */
+
+/* Number of hash buckets. */
+#define FUTEX_BUCKETS 64
+
+/* A hash bucket: the threads sleeping on the futexes that hash
+   to it, in the order that they went to sleep. */
+struct futex_bucket
+  {
+    struct lock lock;                   /* Protects WAITERS. */
+    struct list waiters;                /* List of struct futex_waiter. */
+  };
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter
+  {
+    struct list_elem elem;              /* `waiters' list element. */
+    struct process *process;            /* Process of UADDR. */
+    const int *uaddr;                   /* Futex address. */
+    struct semaphore woken;             /* "Up"ed to wake the thread. */
+  };
+
+/* Initializes the futex wait queues. */
+void
+futex_init (void) 
+{
+  int i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++) 
+    {
+      lock_init (&buckets[i].lock);
+      lock_set_name (&buckets[i].lock, "futex");
+      list_init (&buckets[i].waiters);
+    }
+}
+
+/* Returns the bucket for the futex at UADDR in process P. */
+static struct futex_bucket *
+bucket_for (struct process *p, const int *uaddr) 
+{
+  return &buckets[hash_int ((uintptr_t) uaddr ^ (uintptr_t) p)
+                  % FUTEX_BUCKETS];
+}
+
+/* Returns true if UADDR is a suitably aligned user address for a
+   futex. */
+bool
+futex_valid (const int *uaddr) 
+{
+  return is_user_vaddr (uaddr) && (uintptr_t) uaddr % sizeof *uaddr == 0;
+}
+
+/* Reads the int at user address UADDR into *VALUE.  Returns true
+   if successful, false if UADDR is bad. */
+static bool
+read_user_int (const int *uaddr, int *value) 
+{
+  const uint8_t *usrc = (const uint8_t *) uaddr;
+  uint8_t *dst = (uint8_t *) value;
+  size_t i;
+
+  for (i = 0; i < sizeof *value; i++)
+    if (!get_user (dst + i, usrc + i))
+      return false;
+  return true;
+}
+
+/* If the int at UADDR holds EXPECTED, sleeps until another thread
+   in the process calls futex_wake() on UADDR or the process
+   starts to exit.  Otherwise, returns FUTEX_CHANGED at once. */
+enum futex_result
+futex_wait (int *uaddr, int expected) 
+{
+  struct process *p = thread_current ()->process;
+  struct futex_bucket *b;
+  struct futex_waiter w;
+  int value;
+
+  ASSERT (p != NULL);
+  if (!futex_valid (uaddr))
+    return FUTEX_FAULT;
+
+  b = bucket_for (p, uaddr);
+  lock_acquire (&b->lock);
+  if (!read_user_int (uaddr, &value)) 
+    {
+      lock_release (&b->lock);
+      return FUTEX_FAULT;
+    }
+
+  /* futex_wake_process() takes the bucket lock after P starts
+     exiting, so either we see that here or it wakes us. */
+  if (value != expected || p->exiting) 
+    {
+      lock_release (&b->lock);
+      return FUTEX_CHANGED;
+    }
+
+  w.process = p;
+  w.uaddr = uaddr;
+  sema_init (&w.woken, 0);
+  list_push_back (&b->waiters, &w.elem);
+  lock_release (&b->lock);
+
+  sema_down (&w.woken);
+  return FUTEX_WOKEN;
+}
+
+/* Wakes up to CNT threads of the current process sleeping on the
+   futex at UADDR, oldest first, and returns the number woken. */
+int
+futex_wake (int *uaddr, int cnt) 
+{
+  struct process *p = thread_current ()->process;
+  struct futex_bucket *b;
+  struct list_elem *e, *next;
+  int woken = 0;
+
+  ASSERT (p != NULL);
+  b = bucket_for (p, uaddr);
+  lock_acquire (&b->lock);
+  for (e = list_begin (&b->waiters);
+       e != list_end (&b->waiters) && woken < cnt; e = next) 
+    {
+      struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+      next = list_next (e);
+      if (w->process == p && w->uaddr == uaddr) 
+        {
+          list_remove (e);
+          sema_up (&w->woken);
+          woken++;
+        }
+    }
+  lock_release (&b->lock);
+  return woken;
+}
+
+/* Wakes every thread of process P sleeping on any futex.  P must
+   already be marked as exiting. */
+void
+futex_wake_process (struct process *p) 
+{
+  int i;
+
+  ASSERT (p->exiting);
+  for (i = 0; i < FUTEX_BUCKETS; i++) 
+    {
+      struct futex_bucket *b = &buckets[i];
+      struct list_elem *e, *next;
+
+      lock_acquire (&b->lock);
+      for (e = list_begin (&b->waiters); e != list_end (&b->waiters);
+           e = next) 
+        {
+          struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+          next = list_next (e);
+          if (w->process == p) 
+            {
+              list_remove (e);
+              sema_up (&w->woken);
+            }
+        }
+      lock_release (&b->lock);
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdbool.h>
+
+struct process;
+
+/* Outcome of futex_wait(). */
+enum futex_result
+  {
+    FUTEX_WOKEN,                /* Slept and was woken. */
+    FUTEX_CHANGED,              /* Word did not hold the expected value. */
+    FUTEX_FAULT                 /* Bad user address. */
+  };
+
+void futex_init (void);
+bool futex_valid (const int *uaddr);
+enum futex_result futex_wait (int *uaddr, int expected);
+int futex_wake (int *uaddr, int cnt);
+void futex_wake_process (struct process *);
+
+#endif /* userprog/futex.h */
@@ -16,9 +16,12 @@ static void invalidate_pagedir (uint32_t *);
 uint32_t *
 pagedir_create (void) 
 {
-  uint32_t *pd = palloc_get_page (0);
+  /* The page comes back zeroed, so only the kernel half needs to
+     be copied from init_page_dir. */
+  uint32_t *pd = palloc_get_recycled_page ();
   if (pd != NULL)
-    memcpy (pd, init_page_dir, PGSIZE);
+    memcpy (pd + pd_no (PHYS_BASE), init_page_dir + pd_no (PHYS_BASE),
+            PGSIZE - pd_no (PHYS_BASE) * sizeof *pd);
   return pd;
 }
 
@@ -52,7 +55,7 @@ pagedir_destroy (uint32_t *pd)
             printf("[DEBUG][pagedir_destroy] Deallocating PT. 0x%x\n", (unsigned int)pt);
 #endif
         // Free page table
-        palloc_free_page (pt);
+        palloc_recycle_page (pt);
 
         // [TODO]
         // Here only freed page table memory, but didn't
@@ -61,7 +64,7 @@ pagedir_destroy (uint32_t *pd)
         // logic, code need to be added here to reclaim frames.
         // In this project, we do not implement reclaimation logic.
       }
-  palloc_free_page (pd);
+  palloc_recycle_page (pd);
 }
 
 /* Returns the address of the page table entry for virtual
@@ -87,7 +90,7 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
     {
       if (create)
         {
-          pt = palloc_get_page (PAL_ZERO);
+          pt = palloc_get_recycled_page ();
           if (pt == NULL) 
             return NULL; 
       
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
@@ -23,7 +24,10 @@
 #include "vm/page.h"
 
 static thread_func start_process NO_RETURN;
+static thread_func start_uthread NO_RETURN;
+static bool init_process (void);
 static bool load (const char *cmd_line, void (**eip) (void), void **esp);
+static bool install_page (void *upage, void *kpage, bool writable);
 
 #ifndef VM
 // alternative of vm-related functions in "vm/frame.h"
@@ -89,7 +93,7 @@ start_process (void *exec_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (exec->file_name, &if_.eip, &if_.esp);
+  success = init_process () && load (exec->file_name, &if_.eip, &if_.esp);
 
   /* Allocate wait_status. */
   if (success)
@@ -125,6 +129,317 @@ start_process (void *exec_)
   NOT_REACHED ();
 }
 
+/* Allocates the state that the current thread, as the main
+   thread of a new process, will share with the threads it
+   creates.  Returns true if successful, false on failure. */
+static bool
+init_process (void) 
+{
+  struct thread *cur = thread_current ();
+  struct process *p = malloc (sizeof *p);
+  if (p == NULL)
+    return false;
+
+  p->main = cur;
+  lock_init (&p->lock);
+  cond_init (&p->changed);
+  list_init (&p->uthreads);
+  p->thread_cnt = 0;
+  p->stack_slots = 0;
+  p->exiting = false;
+  cur->process = p;
+  return true;
+}
+
+/* Information passed from process_thread_create() to the new
+   thread's start_uthread(). */
+struct uthread_info
+  {
+    struct process *process;            /* Process to join. */
+    struct uthread *uthread;            /* New thread's status. */
+    void (*entry) (void);               /* User entry point. */
+    void *func, *aux;                   /* Arguments for ENTRY. */
+    struct semaphore started;           /* "Up"ed when INFO is unused. */
+  };
+
+/* Returns the top of the user stack region for stack SLOT. */
+static uint8_t *
+uthread_stack_top (int slot) 
+{
+  return (uint8_t *) PHYS_BASE - MAX_STACK_SIZE - slot * UTHREAD_STACK_SIZE;
+}
+
+/* Starts a new thread in the current process, running user code
+   at ENTRY as if called as ENTRY(FUNC, AUX) with a null return
+   address.  Returns the new thread's id, or TID_ERROR if the
+   process already has UTHREAD_MAX threads, is exiting, or if
+   memory is short. */
+tid_t
+process_thread_create (void (*entry) (void), void *func, void *aux) 
+{
+  struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  struct uthread_info info;
+  struct uthread *u;
+  int slot;
+  tid_t tid;
+
+  if (p == NULL)
+    return TID_ERROR;
+  u = malloc (sizeof *u);
+  if (u == NULL)
+    return TID_ERROR;
+
+  /* Claim a stack region. */
+  lock_acquire (&p->lock);
+  for (slot = 0; slot < UTHREAD_MAX; slot++)
+    if ((p->stack_slots & (1u << slot)) == 0)
+      break;
+  if (p->exiting || slot >= UTHREAD_MAX) 
+    {
+      lock_release (&p->lock);
+      free (u);
+      return TID_ERROR;
+    }
+  p->stack_slots |= 1u << slot;
+  p->thread_cnt++;
+  lock_release (&p->lock);
+
+  u->tid = TID_ERROR;
+  u->stack_slot = slot;
+  u->exit_code = -1;
+  u->exit_called = u->exited = u->joined = false;
+
+#ifdef VM
+  /* Bring in the thread's first stack page now, so that failure
+     is reported here rather than when start_uthread() pushes its
+     arguments from kernel mode.  If the page is evicted before
+     then, faulting it back in cannot fail, because its page table
+     exists and eviction panics rather than fail. */
+  {
+    uint8_t *upage = uthread_stack_top (slot) - PGSIZE;
+    if (!supt_pt_install_stack_page (cur->supt, upage)
+        || !supt_pt_load_page (cur->supt, cur->pagedir, upage)) 
+      {
+        tid = TID_ERROR;
+        goto done;
+      }
+  }
+#else
+  /* Without virtual memory, stacks cannot grow, so each created
+     thread gets a single page, mapped the first time its region
+     is used. */
+  {
+    uint8_t *upage = uthread_stack_top (slot) - PGSIZE;
+    if (pagedir_get_page (cur->pagedir, upage) == NULL) 
+      {
+        uint8_t *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+        if (kpage == NULL || !install_page (upage, kpage, true)) 
+          {
+            palloc_free_page (kpage);
+            tid = TID_ERROR;
+            goto done;
+          }
+      }
+  }
+#endif
+
+  info.process = p;
+  info.uthread = u;
+  info.entry = entry;
+  info.func = func;
+  info.aux = aux;
+  sema_init (&info.started, 0);
+
+  /* The new thread may run, and even exit, before
+     thread_create() returns, so publish U first. */
+  lock_acquire (&p->lock);
+  list_push_back (&p->uthreads, &u->elem);
+  lock_release (&p->lock);
+
+  tid = thread_create (cur->name, PRI_DEFAULT, start_uthread, &info);
+  if (tid != TID_ERROR)
+    {
+      sema_down (&info.started);
+      return tid;
+    }
+
+  lock_acquire (&p->lock);
+  list_remove (&u->elem);
+  lock_release (&p->lock);
+ done:
+  lock_acquire (&p->lock);
+  p->stack_slots &= ~(1u << slot);
+  p->thread_cnt--;
+  cond_broadcast (&p->changed, &p->lock);
+  lock_release (&p->lock);
+  free (u);
+  return tid;
+}
+
+/* A thread function that joins the process in INFO_ and starts
+   running its user code. */
+static void
+start_uthread (void *info_) 
+{
+  struct uthread_info *info = info_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_;
+  uint32_t *esp;
+
+  cur->process = info->process;
+  cur->uthread = info->uthread;
+  lock_acquire (&cur->process->lock);
+  cur->uthread->tid = cur->tid;
+  lock_release (&cur->process->lock);
+  cur->pagedir = info->process->main->pagedir;
+#ifdef VM
+  cur->supt = info->process->main->supt;
+#endif
+  process_activate ();
+
+  /* Push ENTRY's arguments and a null return address, on the
+     stack page mapped by process_thread_create(). */
+  esp = (uint32_t *) uthread_stack_top (cur->uthread->stack_slot);
+  *--esp = (uint32_t) info->aux;
+  *--esp = (uint32_t) info->func;
+  *--esp = 0;
+
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = info->entry;
+  if_.esp = esp;
+  sema_up (&info->started);
+
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Waits for thread TID, which must have been created in the
+   current process, to exit and returns the value it passed to
+   uthread_exit(), or -1 if it was killed.  Returns -1
+   immediately if TID is not a thread of this process, is the
+   caller, or is already being joined, and returns -1 without
+   waiting further if the process begins to exit. */
+int
+process_thread_join (tid_t tid) 
+{
+  struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  struct uthread *u = NULL;
+  struct list_elem *e;
+  int exit_code = -1;
+
+  if (p == NULL || tid == cur->tid)
+    return -1;
+
+  lock_acquire (&p->lock);
+  for (e = list_begin (&p->uthreads); e != list_end (&p->uthreads);
+       e = list_next (e)) 
+    {
+      struct uthread *v = list_entry (e, struct uthread, elem);
+      if (v->tid == tid && !v->joined) 
+        {
+          u = v;
+          break;
+        }
+    }
+  if (u != NULL) 
+    {
+      u->joined = true;
+      while (!u->exited && !p->exiting)
+        cond_wait (&p->changed, &p->lock);
+      if (u->exited) 
+        {
+          exit_code = u->exit_code;
+          list_remove (&u->elem);
+          free (u);
+        }
+      else
+        u->joined = false;
+    }
+  lock_release (&p->lock);
+  return exit_code;
+}
+
+/* Terminates the current thread with EXIT_CODE, to be returned
+   by process_thread_join().  In the main thread, terminates the
+   whole process instead, like exit(). */
+void
+process_thread_exit (int exit_code) 
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->uthread == NULL)
+    process_request_exit (exit_code);
+  else 
+    {
+      lock_acquire (&cur->process->lock);
+      cur->uthread->exit_code = exit_code;
+      cur->uthread->exit_called = true;
+      lock_release (&cur->process->lock);
+    }
+  thread_exit ();
+}
+
+/* Asks for the current process to exit with EXIT_CODE.  Every
+   thread in the process exits the next time it would return to
+   user mode.  Only the first request's EXIT_CODE counts. */
+void
+process_request_exit (int exit_code) 
+{
+  struct process *p = thread_current ()->process;
+  bool first;
+
+  ASSERT (p != NULL);
+  lock_acquire (&p->lock);
+  first = !p->exiting;
+  if (first) 
+    {
+      p->exiting = true;
+      if (p->main->wait_status != NULL)
+        p->main->wait_status->exit_code = exit_code;
+      cond_broadcast (&p->changed, &p->lock);
+    }
+  lock_release (&p->lock);
+
+  if (first)
+    futex_wake_process (p);
+}
+
+/* Called on the way back to user mode.  Exits the current
+   thread if its process is exiting. */
+void
+process_check_exit (void) 
+{
+  struct process *p = thread_current ()->process;
+
+  if (p != NULL && p->exiting) 
+    {
+      intr_enable ();
+      thread_exit ();
+    }
+}
+
+/* Returns true if UADDR lies in the stack region of a thread
+   created in the current process. */
+bool
+process_is_thread_stack (const void *uaddr_) 
+{
+  const uint8_t *uaddr = uaddr_;
+  struct process *p = thread_current ()->process;
+  size_t depth;
+
+  if (p == NULL
+      || uaddr >= uthread_stack_top (0)
+      || uaddr < uthread_stack_top (UTHREAD_MAX))
+    return false;
+  depth = uthread_stack_top (0) - uaddr - 1;
+  return (p->stack_slots & (1u << (depth / UTHREAD_STACK_SIZE))) != 0;
+}
+
 /* Releases one reference to CS and, if it is now unreferenced,
    frees it. */
 static void
@@ -169,14 +484,87 @@ process_wait (tid_t child_tid)
   return -1;
 }
 
+/* Releases the current thread's references to its children's
+   completion status. */
+static void
+release_children (void) 
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *e, *next;
+
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = next) 
+    {
+      struct wait_status *cs = list_entry (e, struct wait_status, elem);
+      next = list_remove (e);
+      release_child (cs);
+    }
+}
+
+/* Gives up the resources of the current thread, which was
+   created with process_thread_create().  The process itself
+   lives on, unless the thread was killed, in which case the
+   process is killed too. */
+static void
+exit_uthread (void) 
+{
+  struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  struct uthread *u = cur->uthread;
+
+  if (!u->exit_called)
+    process_request_exit (-1);
+  release_children ();
+
+  /* Stop using the main thread's page directory before the main
+     thread can destroy it, as in process_exit(). */
+  cur->pagedir = NULL;
+  pagedir_activate (NULL);
+#ifdef VM
+  cur->supt = NULL;
+#endif
+
+  lock_acquire (&p->lock);
+  u->exited = true;
+  p->stack_slots &= ~(1u << u->stack_slot);
+  p->thread_cnt--;
+  cond_broadcast (&p->changed, &p->lock);
+  lock_release (&p->lock);
+
+  cur->process = NULL;
+  cur->uthread = NULL;
+}
+
 /* Free the current process's resources. */
 void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
-  struct list_elem *e, *next;
+  struct process *p = cur->process;
   uint32_t *pd;
 
+  if (cur->uthread != NULL) 
+    {
+      exit_uthread ();
+      return;
+    }
+
+  /* Wait for the process's other threads to exit, since they
+     share everything freed below. */
+  if (p != NULL) 
+    {
+      lock_acquire (&p->lock);
+      p->exiting = true;
+      cond_broadcast (&p->changed, &p->lock);
+      lock_release (&p->lock);
+      futex_wake_process (p);
+
+      lock_acquire (&p->lock);
+      while (p->thread_cnt > 0)
+        cond_wait (&p->changed, &p->lock);
+      lock_release (&p->lock);
+    }
+
   /* Close executable (and allow writes). */
   file_close (cur->bin_file);
 
@@ -190,13 +578,7 @@ process_exit (void)
     }
 
   /* Free entries of children list. */
-  for (e = list_begin (&cur->children); e != list_end (&cur->children);
-       e = next) 
-    {
-      struct wait_status *cs = list_entry (e, struct wait_status, elem);
-      next = list_remove (e);
-      release_child (cs);
-    }
+  release_children ();
 
 #ifdef VM
   /* Destroy the supplemental page table,
@@ -221,6 +603,19 @@ process_exit (void)
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+
+  /* Free the state shared with created threads, all of which
+     have exited. */
+  if (p != NULL) 
+    {
+      while (!list_empty (&p->uthreads)) 
+        {
+          struct list_elem *e = list_pop_front (&p->uthreads);
+          free (list_entry (e, struct uthread, elem));
+        }
+      cur->process = NULL;
+      free (p);
+    }
 }
 
 /* Sets up the CPU for running user code in the current
@@ -440,8 +835,6 @@ load (const char *cmd_line, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
-static bool install_page (void *upage, void *kpage, bool writable);
-
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
 static bool
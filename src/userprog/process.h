@@ -1,11 +1,64 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <list.h>
+#include <stdint.h>
+#include "threads/synch.h"
 #include "threads/thread.h"
 
+/* Maximum size of a process's main stack, which grows down from
+   PHYS_BASE. */
+#define MAX_STACK_SIZE 0x1600000
+
+/* Threads created with uthread_create() get stack regions of
+   UTHREAD_STACK_SIZE bytes each, packed below the main stack.  A
+   process may have up to UTHREAD_MAX of them at once. */
+#define UTHREAD_STACK_SIZE (1024 * 1024)
+#define UTHREAD_MAX 32
+
+/* State shared by all of the threads in a user process.
+
+   The main thread, the one started by process_execute(), owns
+   the page directory, supplemental page table and file
+   descriptor table, and the other threads borrow them.  So that
+   they stay valid, the main thread tears the process down only
+   after all of the other threads have exited. */
+struct process
+  {
+    struct thread *main;                /* Main thread. */
+    struct lock lock;                   /* Protects the members below. */
+    struct condition changed;           /* Signaled when a thread exits
+                                           or the process starts to. */
+    struct list uthreads;               /* struct uthread for each
+                                           created thread. */
+    int thread_cnt;                     /* Created threads not yet exited. */
+    uint32_t stack_slots;               /* Bitmap of stack regions in use. */
+    bool exiting;                       /* Is the process exiting? */
+  };
+
+/* A thread created with uthread_create().  Stays around after
+   the thread exits, until it is joined or the process exits. */
+struct uthread
+  {
+    struct list_elem elem;              /* `uthreads' list element. */
+    tid_t tid;                          /* Thread id. */
+    int stack_slot;                     /* Stack region index. */
+    int exit_code;                      /* Value passed to uthread_exit(). */
+    bool exit_called;                   /* Called uthread_exit()? */
+    bool exited;                        /* Has the thread exited? */
+    bool joined;                        /* Is a thread joining it? */
+  };
+
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
 
+tid_t process_thread_create (void (*entry) (void), void *func, void *aux);
+int process_thread_join (tid_t);
+void process_thread_exit (int exit_code) NO_RETURN;
+void process_request_exit (int exit_code);
+void process_check_exit (void);
+bool process_is_thread_stack (const void *uaddr);
+
 #endif /* userprog/process.h */
@@ -3,9 +3,12 @@
 #include <string.h>
 #include <syscall-nr.h>
 #include "userprog/process.h"
+#include "userprog/futex.h"
 #include "userprog/pagedir.h"
+#include "userprog/uaccess.h"
 #include "devices/input.h"
 #include "devices/shutdown.h"
+#include "devices/timer.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "threads/interrupt.h"
@@ -28,18 +31,37 @@ static int sys_write (int handle, void *usrc_, unsigned size);
 static int sys_seek (int handle, unsigned position);
 static int sys_tell (int handle);
 static int sys_close (int handle);
+static int sys_sched_stats (tid_t, struct sched_stats *ustats);
+static int sys_time_ns (uint64_t *uns);
+static int sys_lockstat (struct lockstat *ustats, int max);
+static int sys_uthread_create (void (*entry) (void), void *func, void *aux);
+static int sys_uthread_join (tid_t);
+static int sys_uthread_exit (int exit_code);
+static int sys_uthread_self (void);
+static int sys_futex_wait (int *uaddr, int expected);
+static int sys_futex_wake (int *uaddr, int cnt);
+static int sys_sched_edf (int period, int budget);
+static int sys_intr_stats (void);
  
 static void syscall_handler (struct intr_frame *);
 static void copy_in (void *, const void *, size_t);
+static void copy_out (void *, const void *, size_t);
  
-/* Serializes file system operations. */
-static struct lock fs_lock;
+/* Serializes file system operations.  Operations that only read
+   file system state hold it for reading, so they may run
+   concurrently; everything else holds it for writing.  Reading
+   and seeking move a file position, which threads of a process
+   share through their common file descriptor table, so they hold
+   it for writing too. */
+static struct rwlock fs_lock;
  
 void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  lock_init (&fs_lock);
+  rwlock_init (&fs_lock);
+  rwlock_set_name (&fs_lock, "fs_lock");
+  futex_init ();
 }
  
 /* System call handler. */
@@ -55,22 +77,34 @@ syscall_handler (struct intr_frame *f)
       syscall_function *func;   /* Implementation. */
     };
 
-  /* Table of system calls. */
+  /* Table of system calls, indexed by system call number.
+     Unimplemented calls have a null FUNC. */
   static const struct syscall syscall_table[] =
     {
-      {0, (syscall_function *) sys_halt},
-      {1, (syscall_function *) sys_exit},
-      {1, (syscall_function *) sys_exec},
-      {1, (syscall_function *) sys_wait},
-      {2, (syscall_function *) sys_create},
-      {1, (syscall_function *) sys_remove},
-      {1, (syscall_function *) sys_open},
-      {1, (syscall_function *) sys_filesize},
-      {3, (syscall_function *) sys_read},
-      {3, (syscall_function *) sys_write},
-      {2, (syscall_function *) sys_seek},
-      {1, (syscall_function *) sys_tell},
-      {1, (syscall_function *) sys_close},
+      [SYS_HALT] = {0, (syscall_function *) sys_halt},
+      [SYS_EXIT] = {1, (syscall_function *) sys_exit},
+      [SYS_EXEC] = {1, (syscall_function *) sys_exec},
+      [SYS_WAIT] = {1, (syscall_function *) sys_wait},
+      [SYS_CREATE] = {2, (syscall_function *) sys_create},
+      [SYS_REMOVE] = {1, (syscall_function *) sys_remove},
+      [SYS_OPEN] = {1, (syscall_function *) sys_open},
+      [SYS_FILESIZE] = {1, (syscall_function *) sys_filesize},
+      [SYS_READ] = {3, (syscall_function *) sys_read},
+      [SYS_WRITE] = {3, (syscall_function *) sys_write},
+      [SYS_SEEK] = {2, (syscall_function *) sys_seek},
+      [SYS_TELL] = {1, (syscall_function *) sys_tell},
+      [SYS_CLOSE] = {1, (syscall_function *) sys_close},
+      [SYS_SCHED_STATS] = {2, (syscall_function *) sys_sched_stats},
+      [SYS_TIME_NS] = {1, (syscall_function *) sys_time_ns},
+      [SYS_LOCKSTAT] = {2, (syscall_function *) sys_lockstat},
+      [SYS_UTHREAD_CREATE] = {3, (syscall_function *) sys_uthread_create},
+      [SYS_UTHREAD_JOIN] = {1, (syscall_function *) sys_uthread_join},
+      [SYS_UTHREAD_EXIT] = {1, (syscall_function *) sys_uthread_exit},
+      [SYS_UTHREAD_SELF] = {0, (syscall_function *) sys_uthread_self},
+      [SYS_FUTEX_WAIT] = {2, (syscall_function *) sys_futex_wait},
+      [SYS_FUTEX_WAKE] = {2, (syscall_function *) sys_futex_wake},
+      [SYS_SCHED_EDF] = {2, (syscall_function *) sys_sched_edf},
+      [SYS_INTR_STATS] = {0, (syscall_function *) sys_intr_stats},
     };
 
   const struct syscall *sc;
@@ -86,6 +120,8 @@ syscall_handler (struct intr_frame *f)
   if (call_nr >= sizeof syscall_table / sizeof *syscall_table)
     thread_exit ();
   sc = syscall_table + call_nr;
+  if (sc->func == NULL)
+    thread_exit ();
 
   /* Get the system call arguments. */
   ASSERT (sc->arg_cnt <= sizeof args / sizeof *args);
@@ -106,30 +142,6 @@ verify_user (const void *uaddr)
           && pagedir_get_page (thread_current ()->pagedir, uaddr) != NULL);
 }
  
-/* Copies a byte from user address USRC to kernel address DST.
-   USRC must be below PHYS_BASE.
-   Returns true if successful, false if a segfault occurred. */
-static inline bool
-get_user (uint8_t *dst, const uint8_t *usrc)
-{
-  int eax;
-  asm ("movl $1f, %%eax; movb %2, %%al; movb %%al, %0; 1:"
-       : "=m" (*dst), "=&a" (eax) : "m" (*usrc));
-  return eax != 0;
-}
- 
-/* Writes BYTE to user address UDST.
-   UDST must be below PHYS_BASE.
-   Returns true if successful, false if a segfault occurred. */
-static inline bool
-put_user (uint8_t *udst, uint8_t byte)
-{
-  int eax;
-  asm ("movl $1f, %%eax; movb %b2, %0; 1:"
-       : "=m" (*udst), "=&a" (eax) : "q" (byte));
-  return eax != 0;
-}
- 
 /* Copies SIZE bytes from user address USRC to kernel address
    DST.
    Call thread_exit() if any of the user accesses are invalid. */
@@ -144,6 +156,20 @@ copy_in (void *dst_, const void *usrc_, size_t size)
       thread_exit ();
 }
  
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.
+   Call thread_exit() if any of the user accesses are invalid. */
+static void
+copy_out (void *udst_, const void *src_, size_t size) 
+{
+  uint8_t *udst = udst_;
+  const uint8_t *src = src_;
+ 
+  for (; size > 0; size--, udst++, src++) 
+    if (udst >= (uint8_t *) PHYS_BASE || !put_user (udst, *src)) 
+      thread_exit ();
+}
+ 
 /* Creates a copy of user string US in kernel memory
    and returns it as a page that must be freed with
    palloc_free_page().
@@ -185,7 +211,7 @@ sys_halt (void)
 static int
 sys_exit (int exit_code) 
 {
-  thread_current ()->wait_status->exit_code = exit_code;
+  process_request_exit (exit_code);
   thread_exit ();
   NOT_REACHED ();
 }
@@ -197,9 +223,9 @@ sys_exec (const char *ufile)
   tid_t tid;
   char *kfile = copy_in_string (ufile);
  
-  lock_acquire (&fs_lock);
+  rwlock_acquire_write (&fs_lock);
   tid = process_execute (kfile);
-  lock_release (&fs_lock);
+  rwlock_release_write (&fs_lock);
  
   palloc_free_page (kfile);
  
@@ -220,9 +246,9 @@ sys_create (const char *ufile, unsigned initial_size)
   char *kfile = copy_in_string (ufile);
   bool ok;
    
-  lock_acquire (&fs_lock);
+  rwlock_acquire_write (&fs_lock);
   ok = filesys_create (kfile, initial_size);
-  lock_release (&fs_lock);
+  rwlock_release_write (&fs_lock);
  
   palloc_free_page (kfile);
  
@@ -236,9 +262,9 @@ sys_remove (const char *ufile)
   char *kfile = copy_in_string (ufile);
   bool ok;
    
-  lock_acquire (&fs_lock);
+  rwlock_acquire_write (&fs_lock);
   ok = filesys_remove (kfile);
-  lock_release (&fs_lock);
+  rwlock_release_write (&fs_lock);
  
   palloc_free_page (kfile);
  
@@ -253,6 +279,16 @@ struct file_descriptor
     int handle;                 /* File handle. */
   };
  
+/* Returns the thread whose file descriptor table the current
+   thread uses, which is the main thread of its process.  The
+   table is modified only with fs_lock held for writing. */
+static struct thread *
+fd_owner (void) 
+{
+  struct thread *cur = thread_current ();
+  return cur->process != NULL ? cur->process->main : cur;
+}
+ 
 /* Open system call. */
 static int
 sys_open (const char *ufile) 
@@ -264,33 +300,40 @@ sys_open (const char *ufile)
   fd = malloc (sizeof *fd);
   if (fd != NULL)
     {
-      lock_acquire (&fs_lock);
+      rwlock_acquire_write (&fs_lock);
       fd->file = filesys_open (kfile);
       if (fd->file != NULL)
         {
-          struct thread *cur = thread_current ();
-          handle = fd->handle = cur->next_handle++;
-          list_push_front (&cur->fds, &fd->elem);
+          struct thread *owner = fd_owner ();
+          handle = fd->handle = owner->next_handle++;
+          list_push_front (&owner->fds, &fd->elem);
         }
       else 
         free (fd);
-      lock_release (&fs_lock);
+      rwlock_release_write (&fs_lock);
     }
   
   palloc_free_page (kfile);
   return handle;
 }
  
-/* Returns the file descriptor associated with the given handle.
-   Terminates the process if HANDLE is not associated with an
-   open file. */
+/* Acquires fs_lock, for writing if WRITE is true, otherwise for
+   reading, and returns the file descriptor associated with the
+   given handle.  The caller must release fs_lock when done with
+   the descriptor, which another thread in the process could
+   otherwise close.  Terminates the process if HANDLE is not
+   associated with an open file. */
 static struct file_descriptor *
-lookup_fd (int handle) 
+lookup_fd (int handle, bool write) 
 {
-  struct thread *cur = thread_current ();
+  struct thread *owner = fd_owner ();
   struct list_elem *e;
    
-  for (e = list_begin (&cur->fds); e != list_end (&cur->fds);
+  if (write)
+    rwlock_acquire_write (&fs_lock);
+  else
+    rwlock_acquire_read (&fs_lock);
+  for (e = list_begin (&owner->fds); e != list_end (&owner->fds);
        e = list_next (e))
     {
       struct file_descriptor *fd;
@@ -298,7 +341,11 @@ lookup_fd (int handle)
       if (fd->handle == handle)
         return fd;
     }
- 
+
+  if (write)
+    rwlock_release_write (&fs_lock);
+  else
+    rwlock_release_read (&fs_lock);
   thread_exit ();
 }
  
@@ -306,12 +353,11 @@ lookup_fd (int handle)
 static int
 sys_filesize (int handle) 
 {
-  struct file_descriptor *fd = lookup_fd (handle);
+  struct file_descriptor *fd = lookup_fd (handle, false);
   int size;
  
-  lock_acquire (&fs_lock);
   size = file_length (fd->file);
-  lock_release (&fs_lock);
+  rwlock_release_read (&fs_lock);
  
   return size;
 }
@@ -333,9 +379,9 @@ sys_read (int handle, void *udst_, unsigned size)
       return bytes_read;
     }
 
-  /* Handle all other reads. */
-  fd = lookup_fd (handle);
-  lock_acquire (&fs_lock);
+  /* Handle all other reads.  Reading advances the file position,
+     which sibling threads share, so hold fs_lock for writing. */
+  fd = lookup_fd (handle, true);
   while (size > 0) 
     {
       /* How much to read into this page? */
@@ -346,7 +392,7 @@ sys_read (int handle, void *udst_, unsigned size)
       /* Check that touching this page is okay. */
       if (!verify_user (udst)) 
         {
-          lock_release (&fs_lock);
+          rwlock_release_write (&fs_lock);
           thread_exit ();
         }
 
@@ -368,7 +414,7 @@ sys_read (int handle, void *udst_, unsigned size)
       udst += retval;
       size -= retval;
     }
-  lock_release (&fs_lock);
+  rwlock_release_write (&fs_lock);
    
   return bytes_read;
 }
@@ -383,9 +429,9 @@ sys_write (int handle, void *usrc_, unsigned size)
 
   /* Lookup up file descriptor. */
   if (handle != STDOUT_FILENO)
-    fd = lookup_fd (handle);
-
-  lock_acquire (&fs_lock);
+    fd = lookup_fd (handle, true);
+  else
+    rwlock_acquire_write (&fs_lock);
   while (size > 0) 
     {
       /* How much bytes to write to this page? */
@@ -396,7 +442,7 @@ sys_write (int handle, void *usrc_, unsigned size)
       /* Check that we can touch this user page. */
       if (!verify_user (usrc)) 
         {
-          lock_release (&fs_lock);
+          rwlock_release_write (&fs_lock);
           thread_exit ();
         }
 
@@ -424,7 +470,7 @@ sys_write (int handle, void *usrc_, unsigned size)
       usrc += retval;
       size -= retval;
     }
-  lock_release (&fs_lock);
+  rwlock_release_write (&fs_lock);
  
   return bytes_written;
 }
@@ -433,12 +479,11 @@ sys_write (int handle, void *usrc_, unsigned size)
 static int
 sys_seek (int handle, unsigned position) 
 {
-  struct file_descriptor *fd = lookup_fd (handle);
+  struct file_descriptor *fd = lookup_fd (handle, true);
    
-  lock_acquire (&fs_lock);
   if ((off_t) position >= 0)
     file_seek (fd->file, position);
-  lock_release (&fs_lock);
+  rwlock_release_write (&fs_lock);
  
   return 0;
 }
@@ -447,12 +492,11 @@ sys_seek (int handle, unsigned position)
 static int
 sys_tell (int handle) 
 {
-  struct file_descriptor *fd = lookup_fd (handle);
+  struct file_descriptor *fd = lookup_fd (handle, false);
   unsigned position;
    
-  lock_acquire (&fs_lock);
   position = file_tell (fd->file);
-  lock_release (&fs_lock);
+  rwlock_release_read (&fs_lock);
  
   return position;
 }
@@ -461,16 +505,123 @@ sys_tell (int handle)
 static int
 sys_close (int handle) 
 {
-  struct file_descriptor *fd = lookup_fd (handle);
-  lock_acquire (&fs_lock);
+  struct file_descriptor *fd = lookup_fd (handle, true);
   file_close (fd->file);
-  lock_release (&fs_lock);
   list_remove (&fd->elem);
+  rwlock_release_write (&fs_lock);
   free (fd);
   return 0;
 }
  
-/* On thread exit, close all open files. */
+/* Sched_stats system call. */
+static int
+sys_sched_stats (tid_t tid, struct sched_stats *ustats) 
+{
+  struct sched_stats stats;
+
+  if (!thread_get_sched_stats (tid, &stats))
+    return false;
+  copy_out (ustats, &stats, sizeof stats);
+  return true;
+}
+ 
+/* Time_ns system call.  The 64-bit result does not fit in the
+   return register, so it is written to *UNS instead. */
+static int
+sys_time_ns (uint64_t *uns) 
+{
+  uint64_t ns = timer_ns ();
+  copy_out (uns, &ns, sizeof ns);
+  return 0;
+}
+ 
+/* Lockstat system call.  Copies up to MAX entries of lock
+   statistics to USTATS and returns the number copied. */
+static int
+sys_lockstat (struct lockstat *ustats, int max) 
+{
+  struct lockstat stat;
+  int cnt;
+
+  for (cnt = 0; cnt < max && lockstat_get (cnt, &stat); cnt++)
+    copy_out (&ustats[cnt], &stat, sizeof stat);
+  return cnt;
+}
+ 
+/* Uthread_create system call.  The user library passes ENTRY, a
+   function that calls FUNC(AUX) and then uthread_exit(). */
+static int
+sys_uthread_create (void (*entry) (void), void *func, void *aux) 
+{
+  return process_thread_create (entry, func, aux);
+}
+ 
+/* Uthread_join system call. */
+static int
+sys_uthread_join (tid_t tid) 
+{
+  return process_thread_join (tid);
+}
+ 
+/* Uthread_exit system call. */
+static int
+sys_uthread_exit (int exit_code) 
+{
+  process_thread_exit (exit_code);
+}
+ 
+/* Uthread_self system call. */
+static int
+sys_uthread_self (void) 
+{
+  return thread_tid ();
+}
+ 
+/* Futex_wait system call.  Returns 0 after being woken, or -1
+   at once if *UADDR does not contain EXPECTED. */
+static int
+sys_futex_wait (int *uaddr, int expected) 
+{
+  switch (futex_wait (uaddr, expected)) 
+    {
+    case FUTEX_WOKEN:
+      return 0;
+    case FUTEX_CHANGED:
+      return -1;
+    default:
+      thread_exit ();
+    }
+}
+ 
+/* Futex_wake system call. */
+static int
+sys_futex_wake (int *uaddr, int cnt) 
+{
+  if (!futex_valid (uaddr))
+    thread_exit ();
+  return futex_wake (uaddr, cnt);
+}
+ 
+/* Sched_edf system call. */
+static int
+sys_sched_edf (int period, int budget) 
+{
+  return thread_set_edf (period, budget);
+}
+ 
+/* Intr_stats system call.  Prints the per-vector interrupt
+   statistics to the console, as at shutdown, so that they can be
+   read while a workload is still running. */
+static int
+sys_intr_stats (void) 
+{
+  intr_print_stats ();
+  return 0;
+}
+ 
+/* On thread exit, close all open files.  Threads created within
+   a process have no files of their own; the main thread, which
+   exits last, closes the files they shared. */
 void
 syscall_exit (void) 
 {
@@ -482,9 +633,9 @@ syscall_exit (void)
       struct file_descriptor *fd;
       fd = list_entry (e, struct file_descriptor, elem);
       next = list_next (e);
-      lock_acquire (&fs_lock);
+      rwlock_acquire_write (&fs_lock);
       file_close (fd->file);
-      lock_release (&fs_lock);
+      rwlock_release_write (&fs_lock);
       free (fd);
     }
 }
@@ -1,63 +1,113 @@
-#include <hash.h>
-#include <list.h>
+#include <round.h>
+#include <stdint.h>
 #include <stdio.h>
 
-#include "lib/kernel/hash.h"
-#include "lib/kernel/list.h"
-#include "threads/malloc.h"
+#include "devices/timer.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
+#include "userprog/process.h"
 #include "vm/frame.h"
+#include "vm/swap.h"
 
 
 // Global lock for ensuring atomic frame operation
 static struct lock frame_lock;
 
-// Map storing mappings from physical address to frame table entry
-struct frame_map
+/**
+ * Frame Table Entry
+ * Stores frame's user page address and metadata, packed into three words.
+ * The frame's kernel page is implied by its index in frame_table.
+ */
+struct frame_table_entry
 {
-    struct hash map;
+    uintptr_t upage;           // User page address (virtual address), page aligned,
+                               // with FTE_* flags in its low bits
+    struct thread* thread;     // The thread associated with this frame
+    uint32_t laundered_index;  // Swap slot the daemon wrote the page to, or NO_SAWP_INDEX.
+                               // Valid as long as the page is not dirtied again.
 };
 
-// frame table
-static struct frame_map frame_table;
-
-// A circular list of frames for the clock eviction algorithm.
-static struct list frame_eviction_candidates;
-static struct list_elem* frame_ptr;
+// Frame table entry flags.
+#define FTE_USED       0x1     // Frame holds a user page; otherwise the entry is free.
+#define FTE_PINNED     0x2     // Frame is not allowed to be evicted.
+#define FTE_PREFETCHED 0x4     // Read ahead from swap, and not yet seen accessed by the clock.
+#define FTE_LAUNDERING 0x8     // Being written to swap by the pageout daemon, not to be evicted.
+#define FTE_FLAGS      PGMASK
+
+// frame table: one entry per frame of the user pool, indexed by
+// (kpage - user_pool_base) / PGSIZE.
+static struct frame_table_entry *frame_table;
+static uint8_t *user_pool_base;
+static size_t frame_used_cnt;               // Number of entries with FTE_USED
+
+// Index of the frame the clock hand points at.
+static size_t clock_hand;
+
+// Pageout daemon. It wakes when fewer than pageout_low user frames are free,
+// and evicts pages until pageout_high are. Dirty pages are first written to
+// swap without frame_lock held ("laundered"), and freed once the clock comes
+// around to them again still clean, so faulting threads rarely wait for a
+// swap write.
+static struct condition pageout_wanted;     // Signaled, with frame_lock, when frames run low
+static struct condition laundry_done;       // Broadcast, with frame_lock, when a laundering ends
+static size_t user_frame_cnt;               // Number of frames in the user pool
+static size_t pageout_low, pageout_high;    // Free frame watermarks
+
+// Statistics
+static long long frame_alloc_cnt;           // Frames allocated
+static long long frame_alloc_ns;            // Time spent in frame_allocate
+static long long direct_evict_cnt;          // Evictions by faulting threads
+static long long pageout_wakeup_cnt;        // Times the daemon woke
+static long long pageout_evict_cnt;         // Evictions by the daemon
+static long long pageout_launder_cnt;       // Pages laundered by the daemon
 
 /**
- * Helper functions for hash table operations.
+ * Frame table entry accessors.
  */
-static unsigned frame_hash_func(const struct hash_elem *elem, void *aux);
-static bool     frame_less_func(const struct hash_elem *, const struct hash_elem *, void *aux);
 
-/**
- * Frame Table Entry
- * Stores frame's virtual/physical addresses and metadata.
- */
-struct frame_table_entry
+// User page address of a frame
+static inline void* fte_upage (const struct frame_table_entry *frame)
 {
-    void* kpage;               // Kernal page, in PintOS kernel page address 0xABCDEF is mapped to the same physical addres (0xABCDEF)
-    void* upage;               // User page address (virtual address)
-    struct thread* thread;     // The thread associated with this frame
-    bool pinned;               // Indicate whether this frame is allowed to be evicted.
-                               // When pinned == true, this frame is not allowed to be evicted.
+    return (void *) (frame->upage & ~FTE_FLAGS);
+}
 
-    struct hash_elem helem;    // see ::frame_map->map 
-    struct list_elem lelem;    // see ::frame_list
-};
+// Kernel page address of a frame
+static inline void* fte_kpage (const struct frame_table_entry *frame)
+{
+    return user_pool_base + (size_t) (frame - frame_table) * PGSIZE;
+}
+
+// Test a frame's FTE_* flag
+static inline bool fte_test (const struct frame_table_entry *frame, uintptr_t flag)
+{
+    return (frame->upage & flag) != 0;
+}
+
+// Set or clear a frame's FTE_* flag
+static inline void fte_set (struct frame_table_entry *frame, uintptr_t flag, bool value)
+{
+    if (value)
+        frame->upage |= flag;
+    else
+        frame->upage &= ~flag;
+}
 
 
 /**
  * Helper functions to perform concrete frame operations
  */
+static void* frame_allocate_internal (enum palloc_flags flags, void *upage, bool prefetch);
+static struct frame_table_entry* frame_lookup (void *kpage);
 static void frame_free_internal (void *kpage, bool free_page);
 static struct frame_table_entry* frame_next_clockwise(void);
-static struct frame_table_entry* frame_pick_one_to_evict();
+static struct frame_table_entry* frame_pick_one_to_evict(bool must);
+static void frame_evict (struct frame_table_entry *frame);
 static void* frame_evict_and_allocate (enum palloc_flags flags);
+static size_t frame_free_cnt (void);
+static bool frame_pageout_one (void);
+static void pageout_daemon (void *aux);
 static void frame_set_pinned (void* kpage, bool isPinned);
 
 
@@ -68,15 +118,43 @@ void frame_init ()
 {
     // Initializ global lock.
     lock_init (&frame_lock);
+    lock_set_name (&frame_lock, "frame_lock");
+
+    // Initialize frame table, with every entry free. It lives in the kernel pool.
+    user_pool_base = palloc_user_pool_base ();
+    user_frame_cnt = palloc_user_page_cnt ();
+    frame_table = palloc_get_multiple (PAL_ASSERT | PAL_ZERO,
+                                       DIV_ROUND_UP (user_frame_cnt * sizeof *frame_table, PGSIZE));
+    frame_used_cnt = 0;
+    clock_hand = 0;
+
+    // Free frame watermarks for the pageout daemon.
+    cond_init (&pageout_wanted);
+    cond_init (&laundry_done);
+    pageout_low = user_frame_cnt / 32 + 1;
+    pageout_high = user_frame_cnt / 16 + 2;
+}
 
-    // Initializ hash table.
-    hash_init (&frame_table.map, frame_hash_func, frame_less_func, NULL);
-    
-    // Initialize circular frame list.
-    list_init (&frame_eviction_candidates);
-    
-    // Initialize there is no frame entry in frame list, so frame_ptr set to null.
-    frame_ptr = NULL;
+
+/**
+ * Start the pageout daemon, which keeps free user frames available.
+ * Must be called after swap_init.
+ */
+void frame_pageout_start (void)
+{
+    thread_create ("pageout", PRI_DEFAULT, pageout_daemon, NULL);
+}
+
+
+/**
+ * Print frame table and pageout statistics.
+ */
+void frame_print_stats (void)
+{
+    printf ("Frame: %lld allocations (%lld ns average), %lld direct evictions; "
+            "pageout: %lld wakeups, %lld evictions, %lld pages laundered\n",
+            frame_alloc_cnt, frame_alloc_cnt > 0 ? frame_alloc_ns / frame_alloc_cnt : 0,
+            direct_evict_cnt, pageout_wakeup_cnt, pageout_evict_cnt, pageout_launder_cnt);
 }
 
 
@@ -87,39 +165,18 @@ void frame_init ()
  */
 void* frame_allocate (enum palloc_flags flags, void *upage)
 {
-    lock_acquire (&frame_lock);
-    
-    // Obtain a page from user pool.
-    void *frame_page = palloc_get_page (PAL_USER | flags);
-    if (frame_page == NULL) {
-        // page allocation failed. Evict frame and allocate a new frame.
-        frame_page = frame_evict_and_allocate(flags);
-    }
-
-    // Create frame table entry
-    struct frame_table_entry* frame = malloc(sizeof(struct frame_table_entry));
-    if (frame == NULL) {
-        // frame table entry allocation failed.
-        // Panic the kernel.
-        lock_release (&frame_lock);
-
-        PANIC ("Cannot create frame table entry -- not enough memory");
-        
-        return NULL;
-    }
-
-    frame->upage = upage;
-    frame->kpage = frame_page;
-    frame->thread = thread_current ();
-    frame->pinned = true;           // Do not allow this frame to be evicted until frame table is fully updated.
-
-    // insert into frame table and frame list
-    hash_insert (&frame_table.map, &frame->helem);
-    list_push_back (&frame_eviction_candidates, &frame->lelem);
+    return frame_allocate_internal (flags, upage, false);
+}
 
-    lock_release (&frame_lock);
 
-    return frame_page;
+/**
+ * Allocate a frame for a page being read ahead from swap, like frame_allocate,
+ * but return NULL rather than evicting another page if no frame is free.
+ * The clock reports to swap_readahead_feedback whether the page was used.
+ */
+void* frame_allocate_prefetch (enum palloc_flags flags, void *upage)
+{
+    return frame_allocate_internal (flags, upage, true);
 }
 
 
@@ -164,6 +221,78 @@ void frame_pin (void* kpage)
  *  ======================================================
  */
 
+/**
+ * Allocate a frame, evicting another page if needed unless PREFETCH is set.
+ */
+static void* frame_allocate_internal (enum palloc_flags flags, void *upage, bool prefetch)
+{
+    uint64_t start = timer_ns ();
+    lock_acquire (&frame_lock);
+
+    // Read-ahead must not eat into the free frames the pageout daemon keeps in reserve.
+    if (prefetch && frame_free_cnt () <= pageout_high) {
+        lock_release (&frame_lock);
+        return NULL;
+    }
+    
+    // Obtain a page from user pool.
+    void *frame_page = palloc_get_page (PAL_USER | flags);
+    if (frame_page == NULL) {
+        if (prefetch) {
+            // Read-ahead is only worth free memory.
+            lock_release (&frame_lock);
+            return NULL;
+        }
+
+        // page allocation failed. Evict frame and allocate a new frame.
+        frame_page = frame_evict_and_allocate(flags);
+        direct_evict_cnt++;
+    }
+
+    // Fill in frame table entry
+    ASSERT (pg_ofs (upage) == 0);
+    struct frame_table_entry* frame = &frame_table[((uint8_t *) frame_page - user_pool_base) / PGSIZE];
+    ASSERT (!fte_test (frame, FTE_USED));
+
+    // Do not allow this frame to be evicted until frame table is fully updated.
+    frame->upage = (uintptr_t) upage | FTE_USED | FTE_PINNED | (prefetch ? FTE_PREFETCHED : 0);
+    // Threads of a process share its main thread's page directory and SPT,
+    // and the main thread exits last, so it owns all of the frames.
+    struct thread *cur = thread_current ();
+    frame->thread = cur->process != NULL ? cur->process->main : cur;
+    frame->laundered_index = NO_SAWP_INDEX;
+    frame_used_cnt++;
+
+    // Wake the pageout daemon if free frames are running low.
+    if (frame_free_cnt () < pageout_low)
+        cond_signal (&pageout_wanted, &frame_lock);
+
+    frame_alloc_cnt++;
+    frame_alloc_ns += timer_ns () - start;
+    lock_release (&frame_lock);
+
+    return frame_page;
+}
+
+
+/**
+ * Lookup the frame table entry for given kernel page.
+ * Return NULL if the page is not a user pool page in use.
+ */
+static struct frame_table_entry* frame_lookup (void *kpage)
+{
+    ASSERT (is_kernel_vaddr(kpage));
+    ASSERT (pg_ofs (kpage) == 0);       // Kernel address should be aligned to page boundary.
+
+    if ((uint8_t *) kpage < user_pool_base
+        || (uint8_t *) kpage >= user_pool_base + user_frame_cnt * PGSIZE)
+        return NULL;
+
+    struct frame_table_entry *frame = &frame_table[((uint8_t *) kpage - user_pool_base) / PGSIZE];
+    return fte_test (frame, FTE_USED) ? frame : NULL;
+}
+
+
 /**
  * Deallocates memory used by a frame.
  * This function MST be called with frame_lock held.
@@ -171,24 +300,23 @@ void frame_pin (void* kpage)
 void frame_free_internal (void *kpage, bool deallocate_frame)
 {
     ASSERT (lock_held_by_current_thread(&frame_lock) == true);
-    ASSERT (is_kernel_vaddr(kpage));
-    ASSERT (pg_ofs (kpage) == 0);       // Kernel address should be aligned to page boundary.
 
     // Lookup frame table entry from frame table
-    struct frame_table_entry temp;
-    temp.kpage = kpage;
-
-    struct hash_elem* elem = hash_find (&frame_table.map, &(temp.helem));
-    if (elem == NULL) {
+    struct frame_table_entry* frame = frame_lookup (kpage);
+    if (frame == NULL) {
         PANIC ("The page to be freed is not stored in the frame table");
     }
 
-    struct frame_table_entry* frame;
-    frame = hash_entry(elem, struct frame_table_entry, helem);
+    // The pageout daemon may be writing the page out; let it finish first.
+    while (fte_test (frame, FTE_LAUNDERING))
+        cond_wait (&laundry_done, &frame_lock);
+    if (frame->laundered_index != NO_SAWP_INDEX)
+        swap_free (frame->laundered_index);
 
-    // Remove the frame table entry from frame table and frame list.
-    hash_delete (&frame_table.map, &frame->helem);
-    list_remove (&frame->lelem);
+    // Remove the frame table entry from frame table.
+    frame->upage = 0;
+    frame->thread = NULL;
+    frame_used_cnt--;
 
     // Free memory used by the kernal frame if needed.
     if (deallocate_frame) {
@@ -197,37 +325,36 @@ void frame_free_internal (void *kpage, bool deallocate_frame)
 #endif
         palloc_free_page(kpage);
     }
-
-    // Free memory used by frame table entry.
-    free(frame);
 }
 
 
 /**
- * Get next frame in frame list.
+ * Advance the clock hand to the next frame in use and return it.
  */
 struct frame_table_entry* frame_next_clockwise (void)
 {
-    if (list_empty(&frame_eviction_candidates))
+    if (frame_used_cnt == 0)
         PANIC("Frame table is empty, which is impossible - there must be some leaks somewhere");
 
-    if (frame_ptr == NULL || frame_ptr == list_end (&frame_eviction_candidates))
-        frame_ptr = list_begin (&frame_eviction_candidates);
-    else
-        frame_ptr = list_next (frame_ptr);
+    // Advance the hand to the next frame in use, wrapping around the table.
+    struct frame_table_entry *frame;
+    do {
+        if (++clock_hand >= user_frame_cnt)
+            clock_hand = 0;
+        frame = &frame_table[clock_hand];
+    } while (!fte_test (frame, FTE_USED));
 
-    struct frame_table_entry *frame = list_entry (frame_ptr, struct frame_table_entry, lelem);
-    
     return frame;
 }
 
 
 /**
  * Pick a frame to be evicted using clock algorithm.
+ * If no frame can be evicted, panic if MUST is set, otherwise return NULL.
  */
-struct frame_table_entry* frame_pick_one_to_evict ()
+struct frame_table_entry* frame_pick_one_to_evict (bool must)
 {
-    size_t n = hash_size (&frame_table.map);
+    size_t n = frame_used_cnt;
     if (n == 0)
         PANIC("Frame table is empty, which is impossible - there must be leaks somewhere");
 
@@ -236,19 +363,30 @@ struct frame_table_entry* frame_pick_one_to_evict ()
     {
         struct frame_table_entry *frame = frame_next_clockwise();
     
-        // if pinned, continue.
-        if (frame->pinned) continue;
+        // if pinned or being laundered, continue.
+        if (fte_test (frame, FTE_PINNED | FTE_LAUNDERING)) continue;
     
         // if referenced, give it a second chance.
-        else if (pagedir_is_accessed (frame->thread->pagedir, frame->upage)) {
-            pagedir_set_accessed (frame->thread->pagedir, frame->upage, false);
+        else if (pagedir_is_accessed (frame->thread->pagedir, fte_upage (frame))) {
+            pagedir_set_accessed (frame->thread->pagedir, fte_upage (frame), false);
+            if (fte_test (frame, FTE_PREFETCHED)) {
+                // A page read ahead was used.
+                fte_set (frame, FTE_PREFETCHED, false);
+                swap_readahead_feedback (true);
+            }
             continue;
         }
 
         // Found the candidate to be evicted : unreferenced since its last chance
+        if (fte_test (frame, FTE_PREFETCHED)) {
+            // A page read ahead is leaving memory without being used.
+            swap_readahead_feedback (false);
+        }
         return frame;
     }
 
+    if (!must)
+        return NULL;
     PANIC ("Cannot evict any frame -- Not enough memory!\n");
 }
 
@@ -261,77 +399,168 @@ struct frame_table_entry* frame_pick_one_to_evict ()
 static void* frame_evict_and_allocate (enum palloc_flags flags)
 {
     // 1. Pick a page and swap it out.
-    struct frame_table_entry *evicted_frame = frame_pick_one_to_evict();
+    frame_evict (frame_pick_one_to_evict(true));
+
+    // 5. Now allocate frame from user pool again, should be allocated successfully.
+    void* frame_page = palloc_get_page (PAL_USER | flags);
+    ASSERT (frame_page != NULL); 
+
+    return frame_page;
+}
+
+
+/**
+ * Evict the page in a frame and free the frame.
+ * This function MUST be called with frame_lock held.
+ */
+static void frame_evict (struct frame_table_entry *evicted_frame)
+{
+    ASSERT (lock_held_by_current_thread(&frame_lock) == true);
     ASSERT (evicted_frame != NULL && evicted_frame->thread != NULL);
 
+    void *upage = fte_upage (evicted_frame);
+    void *kpage = fte_kpage (evicted_frame);
+
     // 2. clear the page mapping, and replace it with swap
     ASSERT (evicted_frame->thread->pagedir != (void*)0xcccccccc);
-    pagedir_clear_page (evicted_frame->thread->pagedir, evicted_frame->upage);
+    pagedir_clear_page (evicted_frame->thread->pagedir, upage);
 
     // 3. Gather dirty bit from kernel page and user page for the page being swapped out.
     bool is_dirty = false;
-    is_dirty = is_dirty || pagedir_is_dirty (evicted_frame->thread->pagedir, evicted_frame->upage);
-    is_dirty = is_dirty || pagedir_is_dirty (evicted_frame->thread->pagedir, evicted_frame->kpage);
-
-    // 4. Swap out frame, update supplemental page table end free physical memory used by evicted frame. 
-    uint32_t swap_idx = swap_out (evicted_frame->kpage);
-    supt_pt_set_swap (evicted_frame->thread->supt, evicted_frame->upage, swap_idx);
-    supt_pt_set_dirty (evicted_frame->thread->supt, evicted_frame->upage, is_dirty);
+    is_dirty = is_dirty || pagedir_is_dirty (evicted_frame->thread->pagedir, upage);
+    is_dirty = is_dirty || pagedir_is_dirty (evicted_frame->thread->pagedir, kpage);
+
+    // 4. If the pageout daemon already wrote the page to swap and it is still clean,
+    //    it is in that slot. Otherwise drop the page if it is clean and can be re-read
+    //    from its file or zeroed again, or return it to the swap slot it came from if it
+    //    is clean and still cached there; otherwise swap it out. Update supplemental
+    //    page table and free physical memory used by evicted frame.
+    struct supplemental_page_table *supt = evicted_frame->thread->supt;
+    uint32_t laundered_index = evicted_frame->laundered_index;
+    evicted_frame->laundered_index = NO_SAWP_INDEX;
+    if (laundered_index != NO_SAWP_INDEX && is_dirty) {
+        // Dirtied again since it was laundered : that copy is stale.
+        swap_free (laundered_index);
+        laundered_index = NO_SAWP_INDEX;
+    }
+    if (laundered_index != NO_SAWP_INDEX) {
+        supt_pt_set_swap (supt, upage, laundered_index);
+        supt_pt_set_dirty (supt, upage, true);
+    }
+    else if (!supt_pt_discard (supt, upage, is_dirty)
+        && !supt_pt_reuse_swap (supt, upage, is_dirty)) {
+        uint32_t swap_idx = swap_out (kpage, &supt->swap_hint);
+        supt_pt_set_swap (supt, upage, swap_idx);
+        // The swap slot now holds the only copy, so the page stays dirty after swap-in.
+        supt_pt_set_dirty (supt, upage, true);
+    }
 
 #ifdef MY_DEBUG
-        printf("[DEBUG][frame_evict_and_allocate] Swap out page 0x%x\n", (unsigned int)evicted_frame->kpage);
+        printf("[DEBUG][frame_evict_and_allocate] Evict page 0x%x\n", (unsigned int)kpage);
 #endif
 
-    frame_free_internal (evicted_frame->kpage, true);  // evicted_frame is also invalidated
+    frame_free_internal (kpage, true);  // evicted_frame is also invalidated
+}
 
-    // 5. Now allocate frame from user pool again, should be allocated successfully.
-    void* frame_page = palloc_get_page (PAL_USER | flags);
-    ASSERT (frame_page != NULL); 
 
-    return frame_page;
+/**
+ * Return the number of free frames in the user pool.
+ * This function MUST be called with frame_lock held.
+ */
+static size_t frame_free_cnt (void)
+{
+    return user_frame_cnt - frame_used_cnt;
 }
 
 
 /**
- * Pin/Unpin a frame.
+ * Pageout daemon main loop.
  */
-static void frame_set_pinned (void* kpage, bool isPinned)
+static void pageout_daemon (void *aux UNUSED)
 {
     lock_acquire (&frame_lock);
-
-    // Lookup frame entry to be pinned/unpinned.
-    struct frame_table_entry temp;
-    temp.kpage = kpage;
-    struct hash_elem *elem = hash_find (&frame_table.map, &(temp.helem));
-    if (elem == NULL) {
-        PANIC ("The frame to be pinned/unpinned does not exist");
+    for (;;) {
+        // Sleep until free frames run low.
+        cond_wait (&pageout_wanted, &frame_lock);
+        pageout_wakeup_cnt++;
+
+        // Free frames up to the high watermark. Give up after two sweeps of the
+        // clock, which happens if most pages are pinned.
+        size_t tries = 2 * frame_used_cnt;
+        while (frame_free_cnt () < pageout_high && tries-- > 0) {
+            if (!frame_pageout_one ())
+                break;
+        }
     }
+}
 
-    struct frame_table_entry *frame = hash_entry (elem, struct frame_table_entry, helem);
-    frame->pinned = isPinned;
 
+/**
+ * Let the pageout daemon advance the clock by one victim: evict it if that
+ * needs no write, or else launder it. Return false if no frame can be evicted.
+ * This function MUST be called with frame_lock held, and may release it meanwhile.
+ */
+static bool frame_pageout_one (void)
+{
+    struct frame_table_entry *frame = frame_pick_one_to_evict (false);
+    if (frame == NULL)
+        return false;
+
+    uint32_t *pagedir = frame->thread->pagedir;
+    struct supplemental_page_table *supt = frame->thread->supt;
+    void *upage = fte_upage (frame);
+    void *kpage = fte_kpage (frame);
+    bool is_dirty = pagedir_is_dirty (pagedir, upage)
+                    || pagedir_is_dirty (pagedir, kpage);
+
+    if (!is_dirty && (frame->laundered_index != NO_SAWP_INDEX
+                      || supt_pt_has_clean_copy (supt, upage))) {
+        // Evicting it is cheap.
+        frame_evict (frame);
+        pageout_evict_cnt++;
+        return true;
+    }
+
+    // Write the page to swap while it stays mapped. If it is dirtied again
+    // meanwhile, the dirty bits tell frame_evict that the copy is stale.
+    // Anyone freeing the frame waits on laundry_done, so frame, supt and the
+    // page stay valid while frame_lock is released.
+    fte_set (frame, FTE_LAUNDERING, true);
+    if (frame->laundered_index != NO_SAWP_INDEX) {
+        swap_free (frame->laundered_index);
+        frame->laundered_index = NO_SAWP_INDEX;
+    }
+    pagedir_set_dirty (pagedir, upage, false);
+    pagedir_set_dirty (pagedir, kpage, false);
     lock_release (&frame_lock);
-}
 
+    uint32_t swap_idx = swap_out (kpage, &supt->swap_hint);
 
-/* =============================================================
- * Implementation of helper functions for hash table operations
- * =============================================================
- */
+    lock_acquire (&frame_lock);
+    frame->laundered_index = swap_idx;
+    fte_set (frame, FTE_LAUNDERING, false);
+    cond_broadcast (&laundry_done, &frame_lock);
+    pageout_launder_cnt++;
 
-// Get hash for an element, using elem->kpage as key
-static unsigned frame_hash_func(const struct hash_elem* elem, void* aux UNUSED)
-{
-    struct frame_table_entry* entry = hash_entry (elem, struct frame_table_entry, helem);
-    
-    return hash_bytes (&entry->kpage, sizeof entry->kpage);
+    return true;
 }
 
 
-// Compare two elements' hash : whether hash(a) < hash(b)
-static bool frame_less_func(const struct hash_elem* a, const struct hash_elem* b, void* aux UNUSED)
+/**
+ * Pin/Unpin a frame.
+ */
+static void frame_set_pinned (void* kpage, bool isPinned)
 {
-  struct frame_table_entry* a_entry = hash_entry (a, struct frame_table_entry, helem);
-  struct frame_table_entry* b_entry = hash_entry (b, struct frame_table_entry, helem);
-  return a_entry->kpage < b_entry->kpage;
+    lock_acquire (&frame_lock);
+
+    // Lookup frame entry to be pinned/unpinned.
+    struct frame_table_entry *frame = frame_lookup (kpage);
+    if (frame == NULL) {
+        PANIC ("The frame to be pinned/unpinned does not exist");
+    }
+
+    fte_set (frame, FTE_PINNED, isPinned);
+
+    lock_release (&frame_lock);
 }
+
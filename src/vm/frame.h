@@ -19,6 +19,13 @@ void frame_init (void);
  */
 void* frame_allocate (enum palloc_flags flags, void *upage);
 
+/**
+ * Allocate a frame for a page being read ahead from swap, like frame_allocate,
+ * but return NULL rather than evicting another page if no frame is free.
+ * The clock reports to swap_readahead_feedback whether the page was used.
+ */
+void* frame_allocate_prefetch (enum palloc_flags flags, void *upage);
+
 /**
  * Remove frame table entry for given kernel page and free memory used by the frame.
  */
@@ -35,4 +42,13 @@ void frame_unpin (void* kpage);
 /** Unpin a kernal page */
 void frame_pin (void* kpage);
 
+/**
+ * Start the pageout daemon, which keeps free user frames available.
+ * Must be called after swap_init.
+ */
+void frame_pageout_start (void);
+
+/** Print frame table and pageout statistics. */
+void frame_print_stats (void);
+
 #endif
\ No newline at end of file
@@ -21,6 +21,11 @@ static void     spte_destroy_func(struct hash_elem* elem, void *aux);
 
 // Helper functions
 static bool     supt_pt_load_page_from_filesys(struct supplemental_page_table_entry *spte, void *kpage);
+static struct supplemental_page_table_entry* supt_pt_find (struct supplemental_page_table *supt, void *upage);
+static bool     supt_pt_insert (struct supplemental_page_table *supt, struct supplemental_page_table_entry *spte);
+static void     supt_pt_readahead (struct supplemental_page_table *supt, uint32_t *pagedir, uint32_t swap_index);
+static bool     supt_pt_prefetch (struct supplemental_page_table *supt, uint32_t *pagedir, void *upage, uint32_t swap_index);
+static void     supt_pt_end_load (struct supplemental_page_table *supt, struct supplemental_page_table_entry *spte);
 
 
 /**
@@ -34,6 +39,10 @@ struct supplemental_page_table* supt_pt_create (void)
 
     // Initialize page map in supplemental page table
     hash_init (&supt->page_map, spte_hash_func, spte_less_func, NULL);
+    rwlock_init (&supt->lock);
+    supt->swap_hint = NO_SAWP_INDEX;
+    lock_init (&supt->load_lock);
+    cond_init (&supt->load_done);
 
     return supt;
 }
@@ -56,9 +65,22 @@ void supt_pt_destroy (struct supplemental_page_table *supt)
  * Return NULL if no such entry is found
  */
 struct supplemental_page_table_entry* supt_pt_lookup (struct supplemental_page_table *supt, void *upage)
+{
+    rwlock_acquire_read (&supt->lock);
+    struct supplemental_page_table_entry *spte = supt_pt_find (supt, upage);
+    rwlock_release_read (&supt->lock);
+
+    return spte;
+}
+
+
+/**
+ * Lookup helper. The caller must hold supt->lock.
+ */
+static struct supplemental_page_table_entry* supt_pt_find (struct supplemental_page_table *supt, void *upage)
 {
 #ifdef MY_DEBUG
-    printf("[DEBUG][supt_pt_lookup] Looking for page %p in SPTE\n", upage);
+    printf("[DEBUG][supt_pt_find] Looking for page %p in SPTE\n", upage);
 #endif
 
     // Create temp spte for looking up the hash table
@@ -99,7 +121,9 @@ bool supt_pt_install_frame (struct supplemental_page_table *supt, void *upage, v
     spte->upage = upage;
     spte->kpage = kpage;
     spte->status = ON_FRAME;
+    spte->origin = ON_FRAME;
     spte->dirty = false;
+    spte->loading = false;
     spte->swap_index = NO_SAWP_INDEX;
 
 #ifdef MY_DEBUG
@@ -107,8 +131,7 @@ bool supt_pt_install_frame (struct supplemental_page_table *supt, void *upage, v
 #endif
 
     // Insert new supplemental page table entry into page table
-    struct hash_elem *prev_elem = hash_insert (&supt->page_map, &spte->elem);
-    if (prev_elem == NULL) {
+    if (supt_pt_insert (supt, spte)) {
         // successfully inserted into supplemental page table
 #ifdef MY_DEBUG
         printf("[DEBUG][supt_pt_install_frame] Successfully added SPTE for upage=%p kpage=%p status=%d dirty=%d swap_index=%d\n", spte->upage, spte->kpage, spte->status, spte->dirty, spte->swap_index);
@@ -137,7 +160,10 @@ bool supt_pt_install_filesys (struct supplemental_page_table *supt, void *upage,
     spte->upage = upage;
     spte->kpage = NULL;
     spte->status = FROM_FILESYS;
+    spte->origin = FROM_FILESYS;
     spte->dirty = false;
+    spte->loading = false;
+    spte->swap_index = NO_SAWP_INDEX;
     spte->file = file;
     spte->file_offset = offset;
     spte->read_bytes = read_bytes;
@@ -147,9 +173,7 @@ bool supt_pt_install_filesys (struct supplemental_page_table *supt, void *upage,
 #ifdef MY_DEBUG
     printf("[DEBUG][supt_pt_install_filesys] Installing page : upage=%p kpage=%p status=%d dirty=%d swap_index=%d file=%s ofs=%x rbytes=%u zbytes=%u writable=%d\n", spte->upage, spte->kpage, spte->status, spte->dirty, spte->swap_index, spte->file, spte->file_offset, spte->read_bytes, spte->zero_bytes, spte->writable);
 #endif
-    struct hash_elem *prev_elem;
-    prev_elem = hash_insert (&supt->page_map, &spte->elem);
-    if (prev_elem == NULL) {
+    if (supt_pt_insert (supt, spte)) {
 
 #ifdef MY_DEBUG
         printf("[DEBUG][supt_pt_install_filesys] Successfully installed page : upage=%p kpage=%p status=%d dirty=%d swap_index=%d\n", spte->upage, spte->kpage, spte->status, spte->dirty, spte->swap_index);
@@ -179,14 +203,15 @@ bool supt_pt_install_zeropage (struct supplemental_page_table *supt, void *upage
     spte->upage = upage;
     spte->kpage = NULL;
     spte->status = ALL_ZERO;
+    spte->origin = ALL_ZERO;
     spte->dirty = false;
+    spte->loading = false;
+    spte->swap_index = NO_SAWP_INDEX;
 
 #ifdef MY_DEBUG
     printf("[DEBUG][supt_pt_install_zeropage] Installing page : upage=%p kpage=%p status=%d dirty=%d swap_index=%d\n", spte->upage, spte->kpage, spte->status, spte->dirty, spte->swap_index);
 #endif
-    struct hash_elem* prev_elem;
-    prev_elem = hash_insert (&supt->page_map, &spte->elem);
-    if (prev_elem == NULL) {
+    if (supt_pt_insert (supt, spte)) {
 #ifdef MY_DEBUG
         printf("[DEBUG][supt_pt_install_zeropage] Successfully installed page : upage=%p kpage=%p status=%d dirty=%d swap_index=%d\n", spte->upage, spte->kpage, spte->status, spte->dirty, spte->swap_index);
 #endif
@@ -204,21 +229,58 @@ bool supt_pt_install_zeropage (struct supplemental_page_table *supt, void *upage
 }
 
 
+/**
+ * Create supplemental page table entry for a new zero-ed stack page, unless
+ * the page already has one. Unlike supt_pt_install_zeropage, another thread
+ * of the process having grown the stack to the same page is not an error.
+ * Return false if out of memory.
+ */
+bool supt_pt_install_stack_page (struct supplemental_page_table *supt, void *upage)
+{
+    if (supt_pt_has_entry (supt, upage))
+        return true;
+
+    struct supplemental_page_table_entry* spte = (struct supplemental_page_table_entry*) malloc(sizeof(struct supplemental_page_table_entry));
+    if (spte == NULL)
+        return false;
+
+    spte->upage = upage;
+    spte->kpage = NULL;
+    spte->status = ALL_ZERO;
+    spte->origin = ALL_ZERO;
+    spte->dirty = false;
+    spte->loading = false;
+    spte->swap_index = NO_SAWP_INDEX;
+
+    // Lost a race with another thread installing it : theirs will do.
+    if (!supt_pt_insert (supt, spte))
+        free (spte);
+    return true;
+}
+
+
 /**
  * Mark a page is swapped out to given swap index
  */
 bool supt_pt_set_swap (struct supplemental_page_table *supt, void *upage, uint32_t swap_index)
 {
-    struct supplemental_page_table_entry* spte = supt_pt_lookup (supt, upage);
+    rwlock_acquire_write (&supt->lock);
+    struct supplemental_page_table_entry* spte = supt_pt_find (supt, upage);
     
     if (spte == NULL) {
         // Didn't find supplemental page table entry for given page
+        rwlock_release_write (&supt->lock);
         return false;
     }
 
+    // Any slot still cached from an earlier swap-in is superseded.
+    if (spte->swap_index != NO_SAWP_INDEX && spte->swap_index != swap_index)
+        swap_drop_cache (spte->swap_index, spte);
+
     spte->status = ON_SWAP;
     spte->kpage = NULL;
     spte->swap_index = swap_index;
+    rwlock_release_write (&supt->lock);
 
     return true;
 }
@@ -236,10 +298,89 @@ bool supt_pt_has_entry (struct supplemental_page_table *supt, void *upage)
 /** Set dirty status for a given page. */
 bool supt_pt_set_dirty (struct supplemental_page_table *supt, void *upage, bool value)
 {
-    struct supplemental_page_table_entry *spte = supt_pt_lookup(supt, upage);
+    rwlock_acquire_write (&supt->lock);
+    struct supplemental_page_table_entry *spte = supt_pt_find (supt, upage);
     if (spte == NULL) PANIC("Set dirty - the request page doesn't exist in supplemental page table.");
 
     spte->dirty = value;
+    rwlock_release_write (&supt->lock);
+    return true;
+}
+
+
+/**
+ * Drop a page that has been evicted from its frame without writing it anywhere,
+ * if it is not DIRTY and can be rebuilt from its origin: re-read from its file,
+ * or zeroed again. The SPTE reverts to FROM_FILESYS or ALL_ZERO.
+ * Return false if the page must be swapped out instead.
+ */
+bool supt_pt_discard (struct supplemental_page_table *supt, void *upage, bool dirty)
+{
+    rwlock_acquire_write (&supt->lock);
+    struct supplemental_page_table_entry *spte = supt_pt_find (supt, upage);
+    if (spte == NULL) PANIC("Discard - the request page doesn't exist in supplemental page table.");
+
+    if (dirty || spte->dirty || spte->origin == ON_FRAME) {
+        rwlock_release_write (&supt->lock);
+        return false;
+    }
+
+    spte->status = spte->origin;
+    spte->kpage = NULL;
+    rwlock_release_write (&supt->lock);
+    return true;
+}
+
+
+/**
+ * Return whether a page whose dirty bits are clear could be evicted without
+ * writing it: it can be rebuilt from its origin, or is cached in a swap slot.
+ */
+bool supt_pt_has_clean_copy (struct supplemental_page_table *supt, void *upage)
+{
+    rwlock_acquire_read (&supt->lock);
+    struct supplemental_page_table_entry *spte = supt_pt_find (supt, upage);
+    if (spte == NULL) PANIC("Clean copy - the request page doesn't exist in supplemental page table.");
+
+    bool clean = (!spte->dirty && spte->origin != ON_FRAME) || spte->swap_index != NO_SAWP_INDEX;
+    rwlock_release_read (&supt->lock);
+    return clean;
+}
+
+
+/**
+ * Evict a page that was read in from swap back to the slot it came from,
+ * without writing it, if it has not been DIRTY since. A dirty page's
+ * cached slot is stale, so it is freed instead.
+ * Return false if the page must be written to a new slot.
+ */
+bool supt_pt_reuse_swap (struct supplemental_page_table *supt, void *upage, bool dirty)
+{
+    rwlock_acquire_write (&supt->lock);
+    struct supplemental_page_table_entry *spte = supt_pt_find (supt, upage);
+    if (spte == NULL) PANIC("Reuse swap - the request page doesn't exist in supplemental page table.");
+
+    if (spte->swap_index == NO_SAWP_INDEX) {
+        rwlock_release_write (&supt->lock);
+        return false;
+    }
+
+    if (dirty) {
+        swap_drop_cache (spte->swap_index, spte);
+        spte->swap_index = NO_SAWP_INDEX;
+        rwlock_release_write (&supt->lock);
+        return false;
+    }
+
+    if (!swap_reuse (spte->swap_index, spte)) {
+        // The slot was reclaimed for another page.
+        spte->swap_index = NO_SAWP_INDEX;
+        rwlock_release_write (&supt->lock);
+        return false;
+    }
+    spte->status = ON_SWAP;
+    spte->kpage = NULL;
+    rwlock_release_write (&supt->lock);
     return true;
 }
 
@@ -249,29 +390,45 @@ bool supt_pt_set_dirty (struct supplemental_page_table *supt, void *upage, bool
  */
 bool supt_pt_load_page(struct supplemental_page_table *supt, uint32_t *pagedir, void *upage)
 {
-    // Check whether memory reference is valid
-    struct supplemental_page_table_entry *spte = supt_pt_lookup (supt, upage);
-    
+    // Check whether memory reference is valid. If another thread of the
+    // process is loading the page, wait for it and look again.
+    struct supplemental_page_table_entry *spte;
+    lock_acquire (&supt->load_lock);
+    for (;;) {
+        spte = supt_pt_lookup (supt, upage);
+        if (spte == NULL || !spte->loading)
+            break;
+        cond_wait (&supt->load_done, &supt->load_lock);
+    }
+
     if (spte == NULL) {
         // No supplemental page table entry for given page
+        lock_release (&supt->load_lock);
         return false;
     }
 
     // If page not already on a frame, obtain a frame to store the page
     if (spte->status == ON_FRAME) {
         // Page already on a frame
+        lock_release (&supt->load_lock);
         return true;
     }
 
+    // Claim the page, so that no other thread loads it meanwhile.
+    spte->loading = true;
+    lock_release (&supt->load_lock);
+
     void* frame_kpage = frame_allocate (PAL_USER, upage);
 
     if (frame_kpage == NULL) {
         // Failed to allocate new frame
+        supt_pt_end_load (supt, spte);
         return false;
     }
 
     // Fetch data into frame
     bool writable = true;
+    uint32_t swapped_from = NO_SAWP_INDEX;
     switch (spte->status) {
         case ALL_ZERO:
             memset (frame_kpage, 0, PGSIZE);
@@ -282,8 +439,10 @@ bool supt_pt_load_page(struct supplemental_page_table *supt, uint32_t *pagedir,
             break;
 
         case ON_SWAP:
-            // Data is on swap, load the data back from swap
+            // Data is on swap, load the data back from swap.
+            // The slot stays in spte->swap_index as a cached copy, if kept.
             swap_in (spte->swap_index, frame_kpage);
+            swapped_from = spte->swap_index;
             break;
         
         case FROM_FILESYS:
@@ -294,6 +453,7 @@ bool supt_pt_load_page(struct supplemental_page_table *supt, uint32_t *pagedir,
                 printf("[DEBUG][supt_pt_load_page] failed to load page 0x%x from filesys\n", (unsigned int) frame);
 #endif
                 frame_free (frame_kpage);
+                supt_pt_end_load (supt, spte);
                 return false;
             }
 
@@ -311,18 +471,127 @@ bool supt_pt_load_page(struct supplemental_page_table *supt, uint32_t *pagedir,
         printf("[DEBUG][supt_pt_load_page] failed to set page 0x%x in page dir, writable=%d\n", (unsigned int) frame, writable);
 #endif
         frame_free (frame_kpage);
+        supt_pt_end_load (supt, spte);
         return false;
     }
 
     // Save physical address to supplemental page table and update its status
+    bool swap_cached = swapped_from != NO_SAWP_INDEX && swap_cache (swapped_from, spte);
+    rwlock_acquire_write (&supt->lock);
     spte->kpage = frame_kpage;
     spte->status = ON_FRAME;
+    if (swapped_from != NO_SAWP_INDEX && !swap_cached)
+        spte->swap_index = NO_SAWP_INDEX;
+    rwlock_release_write (&supt->lock);
+    supt_pt_end_load (supt, spte);
 
     pagedir_set_dirty (pagedir, frame_kpage, false);
 
     // Unpin frame
     frame_unpin (frame_kpage);
 
+    // A page that came from swap likely has neighbours there that are about to fault too.
+    if (swapped_from != NO_SAWP_INDEX)
+        supt_pt_readahead (supt, pagedir, swapped_from);
+
+    return true;
+}
+
+
+/**
+ * Release a page claimed for loading, and wake the threads waiting for it.
+ */
+static void supt_pt_end_load (struct supplemental_page_table *supt, struct supplemental_page_table_entry *spte)
+{
+    lock_acquire (&supt->load_lock);
+    spte->loading = false;
+    cond_broadcast (&supt->load_done, &supt->load_lock);
+    lock_release (&supt->load_lock);
+}
+
+
+/**
+ * Swap readahead : after a page was read from swap_index slot, read in the
+ * pages of the same address space in the slots right after it, up to the
+ * readahead window, stopping at the first slot that is not one of ours.
+ */
+static void supt_pt_readahead (struct supplemental_page_table *supt, uint32_t *pagedir, uint32_t swap_index)
+{
+    size_t window = swap_readahead_window ();
+    void *upages[SWAP_READAHEAD_MAX];
+    size_t i;
+
+    ASSERT (window <= SWAP_READAHEAD_MAX);
+    for (i = 0; i < window; ++i)
+        upages[i] = NULL;
+
+    // Find our pages in the following slots. Only collect them here: loading
+    // takes frame_lock, which the evictor holds while taking supt->lock.
+    struct hash_iterator it;
+    rwlock_acquire_read (&supt->lock);
+    hash_first (&it, &supt->page_map);
+    while (hash_next (&it)) {
+        struct supplemental_page_table_entry *spte =
+            hash_entry (hash_cur (&it), struct supplemental_page_table_entry, elem);
+        if (spte->status == ON_SWAP && spte->swap_index > swap_index
+            && spte->swap_index - swap_index <= window)
+            upages[spte->swap_index - swap_index - 1] = spte->upage;
+    }
+    rwlock_release_read (&supt->lock);
+
+    for (i = 0; i < window && upages[i] != NULL; ++i) {
+        if (!supt_pt_prefetch (supt, pagedir, upages[i], swap_index + i + 1))
+            break;
+    }
+}
+
+
+/**
+ * Read a page ahead from swap_index slot into a free frame and map it,
+ * not accessed, so that the clock can tell whether it gets used.
+ * Return false if there is no free frame.
+ */
+static bool supt_pt_prefetch (struct supplemental_page_table *supt, uint32_t *pagedir, void *upage, uint32_t swap_index)
+{
+    void *frame_kpage = frame_allocate_prefetch (PAL_USER, upage);
+    if (frame_kpage == NULL)
+        return false;
+
+    // The page may have been faulted in since we looked, or be loading now.
+    // Otherwise claim it, so that a thread faulting on it waits for the read.
+    lock_acquire (&supt->load_lock);
+    struct supplemental_page_table_entry *spte = supt_pt_lookup (supt, upage);
+    bool claimed = spte != NULL && !spte->loading
+                   && spte->status == ON_SWAP && spte->swap_index == swap_index;
+    if (claimed)
+        spte->loading = true;
+    lock_release (&supt->load_lock);
+
+    if (!claimed) {
+        frame_free (frame_kpage);
+        return true;
+    }
+
+    swap_in_ahead (swap_index, frame_kpage);
+    if (!pagedir_set_page (pagedir, upage, frame_kpage, true)) {
+        frame_free (frame_kpage);
+        supt_pt_end_load (supt, spte);
+        return false;
+    }
+
+    bool swap_cached = swap_cache (swap_index, spte);
+    rwlock_acquire_write (&supt->lock);
+    spte->kpage = frame_kpage;
+    spte->status = ON_FRAME;
+    if (!swap_cached)
+        spte->swap_index = NO_SAWP_INDEX;
+    rwlock_release_write (&supt->lock);
+    supt_pt_end_load (supt, spte);
+
+    pagedir_set_dirty (pagedir, frame_kpage, false);
+    pagedir_set_accessed (pagedir, upage, false);
+    frame_unpin (frame_kpage);
+
     return true;
 }
 
@@ -357,6 +626,20 @@ void supt_pt_unpin_page(struct supplemental_page_table *supt, void *page)
 }
 
 
+/**
+ * Insert SPTE into the supplemental page table under the write lock.
+ * Return false if there is already an entry for its page.
+ */
+static bool supt_pt_insert (struct supplemental_page_table *supt, struct supplemental_page_table_entry *spte)
+{
+    rwlock_acquire_write (&supt->lock);
+    struct hash_elem *prev_elem = hash_insert (&supt->page_map, &spte->elem);
+    rwlock_release_write (&supt->lock);
+
+    return prev_elem == NULL;
+}
+
+
 /**
  * Hash table helper functions, use upage as key.
  */
@@ -388,8 +671,13 @@ static void spte_destroy_func(struct hash_elem* elem, void* aux UNUSED)
     ASSERT (entry->status == ON_FRAME);
     frame_remove_entry (entry->kpage);
   }
-  else if(entry->status == ON_SWAP) {
-    swap_free (entry->swap_index);
+
+  // Free the swap slot, whether the page is swapped out or only cached there.
+  if (entry->swap_index != NO_SAWP_INDEX) {
+    if (entry->status == ON_SWAP)
+      swap_free (entry->swap_index);
+    else
+      swap_drop_cache (entry->swap_index, entry);
   }
 
   // Clean up SPTE entry.
@@ -403,10 +691,9 @@ static void spte_destroy_func(struct hash_elem* elem, void* aux UNUSED)
  */
 static bool supt_pt_load_page_from_filesys(struct supplemental_page_table_entry* spte, void* frame)
 {
-  file_seek (spte->file, spte->file_offset);
-
-  // read bytes from the file
-  int bytes_read = file_read (spte->file, frame, spte->read_bytes);
+  // read bytes from the file. Threads of the process share the file, so
+  // read at the page's offset without moving the file position.
+  int bytes_read = file_read_at (spte->file, frame, spte->read_bytes, spte->file_offset);
   if(bytes_read != (int)spte->read_bytes)
     return false;
 
@@ -4,6 +4,7 @@
 #include "vm/swap.h"
 #include <hash.h>
 #include "filesys/off_t.h"
+#include "threads/synch.h"
 
 
 /**
@@ -23,6 +24,12 @@ enum page_status {
 struct supplemental_page_table
 {
     struct hash page_map;
+    struct rwlock lock;     // Guards page_map. Lookups take it for reading,
+                            // the evictor and installs for writing.
+    uint32_t swap_hint;     // Swap allocation hint, see swap_out(). Guarded by the
+                            // swap allocator's lock.
+    struct lock load_lock;  // Guards the entries' loading flags.
+    struct condition load_done; // Broadcast, with load_lock, when a page finishes loading.
 };
 
 /**
@@ -35,10 +42,17 @@ struct supplemental_page_table_entry
                                 // If the page is not on the frame, this pointer should be NULL
     struct hash_elem elem;      // Hash elements
     enum page_status status;    // Page status
-    bool dirty;                 // Dirty bit
+    enum page_status origin;    // Where the page's contents first came from: ALL_ZERO or
+                                // FROM_FILESYS, or ON_FRAME for pages installed directly
+                                // in a frame, which have no copy outside memory.
+    bool dirty;                 // Dirty bit: the page no longer matches its origin
+    bool loading;               // A thread is bringing the page into a frame. Threads of a
+                                // process share its SPT, so others faulting on the page wait.
     
-    // Only valid for status = ON_SWAP
-    uint32_t swap_index;        // Stores the swap index if the page is sapped out, only effictive when status = ON_SWAP
+    // Valid for status = ON_SWAP, and for status = ON_FRAME after a swap-in
+    uint32_t swap_index;        // Stores the swap index if the page is sapped out. After swap-in the slot
+                                // may be kept (swap cache) until the page is found dirty or destroyed,
+                                // otherwise NO_SAWP_INDEX. Swap may reclaim a kept slot, see swap_cache().
     
     // Only valid for status == FROM_FILESYS
     struct file *file;
@@ -70,6 +84,9 @@ bool supt_pt_install_filesys (struct supplemental_page_table *supt, void *upage,
 // Create supplemental page table entry for a new zero-ed page.
 bool supt_pt_install_zeropage (struct supplemental_page_table *supt, void *upage);
 
+// Create supplemental page table entry for a new zero-ed stack page, if it has none.
+bool supt_pt_install_stack_page (struct supplemental_page_table *supt, void *upage);
+
 // Mark a page is swapped out to given swap index
 bool supt_pt_set_swap (struct supplemental_page_table *supt, void *upage, uint32_t swap_index);
 
@@ -79,6 +96,15 @@ bool supt_pt_has_entry (struct supplemental_page_table *supt, void *upage);
 // Set a page's dirty bit
 bool supt_pt_set_dirty (struct supplemental_page_table *supt, void *upage, bool);
 
+// Drop an evicted page that still matches its origin, reverting it to that origin
+bool supt_pt_discard (struct supplemental_page_table *supt, void *upage, bool dirty);
+
+// Evict a page back to the swap slot it was read from, if it is still clean
+bool supt_pt_reuse_swap (struct supplemental_page_table *supt, void *upage, bool dirty);
+
+// Return whether a page that is not dirty could be evicted without writing it
+bool supt_pt_has_clean_copy (struct supplemental_page_table *supt, void *upage);
+
 // Load page back to frame from swap
 bool supt_pt_load_page(struct supplemental_page_table *supt, uint32_t *pagedir, void *upage);
 
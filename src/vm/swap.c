@@ -1,8 +1,13 @@
 #include <bitmap.h>
+#include <round.h>
+#include <stdio.h>
 
+#include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "devices/block.h"
 #include "vm/swap.h"
+#include "vm/zswap.h"
 
 static struct block* swap_slots;                   // Swap slots
 static struct bitmap* available_slot_bitmap;       // Bitmap recording available slots
@@ -12,6 +17,53 @@ static const size_t SECTORS_PER_PAGE = PGSIZE / BLOCK_SECTOR_SIZE; // How many s
 // The number of possible swapped pages
 static size_t max_swap_page_count;
 
+// Slots are handed out in aligned clusters of this many contiguous slots.
+// Each address space fills a cluster of its own before starting another,
+// so pages evicted together, and pages of the same process, end up next
+// to each other on disk.
+#define SWAP_CLUSTER_SLOTS 16
+
+static size_t swap_cluster_count;   // Number of whole clusters on the swap disk
+static size_t swap_cursor;          // Next-fit cursor: cluster at which the search
+                                    // for a free cluster starts
+static uint32_t swap_default_hint;  // Cluster hint for callers without one of their own
+static size_t swap_used_cnt;        // Number of slots in use
+
+// Swap cache back-map: for each slot kept after swap-in as a copy of a
+// resident page, the owner it was kept for, otherwise null. Such slots are
+// reclaimed when swap runs full, and no longer kept once it is half full.
+static const void **swap_cache_owner;
+static size_t swap_reclaim_cursor;  // Slot at which the search for one to reclaim starts
+
+// Guards available_slot_bitmap, swap_cache_owner, the cursors, hints and
+// statistics. Never held across disk I/O. May be held while taking zswap_lock.
+static struct lock swap_lock;
+
+// Serializes writes to the swap disk, so that a page zswap writes back
+// cannot land on a slot after newer content written there directly.
+// Also guards writeback_page.
+static struct lock swap_write_lock;
+static void *writeback_page;        // Page zswap decompresses into for writeback
+
+// Statistics
+static long long swap_write_cnt;    // Pages written to swap disk
+static long long swap_read_cnt;     // Pages read from swap disk
+static long long swap_reuse_cnt;    // Evictions that reused a cached slot instead of writing
+static long long swap_reclaim_cnt;  // Cached slots reclaimed for lack of a free one
+static long long swap_cluster_cnt;  // Fresh clusters started
+static long long swap_scatter_cnt;  // Slots allocated outside a cluster, for lack of a free one
+static long long swap_ahead_cnt;    // Pages read ahead
+static long long swap_ahead_used;   // Pages read ahead that were used
+static long long swap_ahead_unused; // Pages read ahead that were evicted unused
+
+// Slots read ahead after a swap-in. Grows by one for every page read ahead
+// that gets used, and halves for every one evicted unused.
+static size_t readahead_window = 2;
+
+static size_t swap_alloc (uint32_t *hint);
+static size_t swap_reclaim (void);
+static void swap_write (uint32_t swap_index, const void *page);
+
 /**
  * Initialize swap, Must be called ONLY ONCE at the initialization phase.
  */
@@ -32,31 +84,58 @@ void swap_init (void)
     max_swap_page_count = block_size(swap_slots) / SECTORS_PER_PAGE;
     available_slot_bitmap = bitmap_create(max_swap_page_count);
     bitmap_set_all(available_slot_bitmap, true);
+
+    swap_cache_owner = palloc_get_multiple (PAL_ASSERT | PAL_ZERO,
+                                            DIV_ROUND_UP (max_swap_page_count * sizeof *swap_cache_owner, PGSIZE));
+    swap_used_cnt = 0;
+    swap_reclaim_cursor = 0;
+
+    swap_cluster_count = max_swap_page_count / SWAP_CLUSTER_SLOTS;
+    swap_cursor = 0;
+    swap_default_hint = NO_SAWP_INDEX;
+    lock_init (&swap_lock);
+    lock_set_name (&swap_lock, "swap_lock");
+    lock_init (&swap_write_lock);
+    lock_set_name (&swap_write_lock, "swap_write_lock");
+    writeback_page = palloc_get_page (PAL_ASSERT);
+
+    zswap_init ();
 }
 
 
 /**
  * Swap out the content in given page into swap disk.
  * Return the index of swap slot in which it is placed.
+ * The content goes to zswap instead if it compresses well.
  */
-uint32_t swap_out (void* page)
+uint32_t swap_out (void* page, uint32_t *hint)
 {
     // Ensure that the page is on kernel virtual memory.
     ASSERT (page >= PHYS_BASE);
 
     // Find an available block slot to use
-    size_t swap_index = bitmap_scan (available_slot_bitmap, /*start*/0, /*cnt*/1, true);
+    lock_acquire (&swap_lock);
+    size_t swap_index = swap_alloc (hint);
+    lock_release (&swap_lock);
 
-    // Write all content to swap slot
-    size_t i = 0;
-    for (; i < SECTORS_PER_PAGE; ++i) {
-        block_write(swap_slots,
-            /* sector number */  swap_index * SECTORS_PER_PAGE + i,
-            /* target address */ (char*)page + (BLOCK_SECTOR_SIZE * i));
-    }
+    // Compress before taking swap_write_lock, which is held across disk I/O.
+    struct zswap_entry *compressed = zswap_compress (page);
 
-    // Mark the slot is used
-    bitmap_set(available_slot_bitmap, swap_index, false);
+    lock_acquire (&swap_write_lock);
+    if (compressed != NULL) {
+        zswap_store (swap_index, compressed);
+
+        // Keep zswap within its memory limit by moving its least recently
+        // used pages on to the disk.
+        uint32_t writeback_index;
+        while (zswap_writeback_begin (&writeback_index, writeback_page)) {
+            swap_write (writeback_index, writeback_page);
+            zswap_writeback_end (writeback_index);
+        }
+    }
+    else
+        swap_write (swap_index, page);
+    lock_release (&swap_write_lock);
 
     return swap_index;
 }
@@ -72,10 +151,15 @@ void swap_in (uint32_t swap_index, void* page)
 
     // check the swap slot
     ASSERT (swap_index < max_swap_page_count);
+    lock_acquire (&swap_lock);
     if (bitmap_test (available_slot_bitmap, swap_index) == true) {
         // Trying to swap an unassigned swap slot in, error
         PANIC ("Error, invalid read access to unassigned swap block");
     }
+    lock_release (&swap_lock);
+
+    if (zswap_load (swap_index, page))
+        return;
 
     // Read a page content back from swap slot
     size_t i = 0;
@@ -86,8 +170,119 @@ void swap_in (uint32_t swap_index, void* page)
             );
     }
 
-    // Mark swap slot available
-    bitmap_set(available_slot_bitmap, swap_index, true);
+    lock_acquire (&swap_lock);
+    swap_read_cnt++;
+    lock_release (&swap_lock);
+
+    // The slot is kept until the caller decides, see swap_cache.
+}
+
+
+/**
+ * Read content in swap_index slot into given page ahead of any fault on it,
+ * as swap_in does.
+ */
+void swap_in_ahead (uint32_t swap_index, void* page)
+{
+    swap_in (swap_index, page);
+
+    lock_acquire (&swap_lock);
+    swap_ahead_cnt++;
+    lock_release (&swap_lock);
+}
+
+
+/**
+ * Return how many slots following a swapped-in one should be read ahead.
+ */
+size_t swap_readahead_window (void)
+{
+    return readahead_window;
+}
+
+
+/**
+ * Report whether a page read ahead was USED before it was evicted again,
+ * which grows or shrinks the readahead window.
+ */
+void swap_readahead_feedback (bool used)
+{
+    lock_acquire (&swap_lock);
+    if (used) {
+        swap_ahead_used++;
+        if (readahead_window < SWAP_READAHEAD_MAX)
+            readahead_window++;
+    } else {
+        swap_ahead_unused++;
+        if (readahead_window > 1)
+            readahead_window /= 2;
+    }
+    lock_release (&swap_lock);
+}
+
+
+/**
+ * Keep swap_index slot, which a page was read in from, as a cached copy of
+ * the page for OWNER, so that the page can go back to it without being
+ * written again. Unless swap is more than half full: then the slot is freed.
+ * Return whether it is kept.
+ */
+bool swap_cache (uint32_t swap_index, const void *owner)
+{
+    ASSERT (swap_index < max_swap_page_count);
+    ASSERT (owner != NULL);
+
+    lock_acquire (&swap_lock);
+    bool keep = swap_used_cnt * 2 <= max_swap_page_count;
+    if (keep)
+        swap_cache_owner[swap_index] = owner;
+    lock_release (&swap_lock);
+
+    if (!keep)
+        swap_free (swap_index);
+    return keep;
+}
+
+
+/**
+ * Record that a page still matching its copy in swap_index slot, cached for
+ * OWNER, was evicted back to that slot without writing it. The slot holds
+ * the page's only copy from now on.
+ * Return false if the slot was reclaimed meanwhile and the page must be written.
+ */
+bool swap_reuse (uint32_t swap_index, const void *owner)
+{
+    ASSERT (swap_index < max_swap_page_count);
+    lock_acquire (&swap_lock);
+    if (swap_cache_owner[swap_index] != owner) {
+        lock_release (&swap_lock);
+        return false;
+    }
+    if (bitmap_test (available_slot_bitmap, swap_index) == true) {
+        PANIC ("Error, reuse of unassigned swap block");
+    }
+
+    swap_cache_owner[swap_index] = NULL;
+    swap_reuse_cnt++;
+    lock_release (&swap_lock);
+    return true;
+}
+
+
+/**
+ * Drop swap_index slot cached for OWNER, unless it was reclaimed meanwhile.
+ */
+void swap_drop_cache (uint32_t swap_index, const void *owner)
+{
+    ASSERT (swap_index < max_swap_page_count);
+    lock_acquire (&swap_lock);
+    bool owned = swap_cache_owner[swap_index] == owner;
+    if (owned)
+        swap_cache_owner[swap_index] = NULL;
+    lock_release (&swap_lock);
+
+    if (owned)
+        swap_free (swap_index);
 }
 
 /**
@@ -98,10 +293,145 @@ void swap_free (uint32_t swap_index)
     // check the swap region
     ASSERT (swap_index < max_swap_page_count);
 
+    // Drop any compressed copy before the slot can be handed out again.
+    zswap_invalidate (swap_index);
+
+    lock_acquire (&swap_lock);
     if (bitmap_test (available_slot_bitmap, swap_index) == true) {
         PANIC ("Error, invalid free request to unassigned swap block");
     }
 
     // Mark swap slot is available
     bitmap_set(available_slot_bitmap, swap_index, true);
+    swap_cache_owner[swap_index] = NULL;
+    swap_used_cnt--;
+    lock_release (&swap_lock);
+}
+
+
+/**
+ * Print swap statistics.
+ */
+void swap_print_stats (void)
+{
+    printf ("Swap: %lld pages written, %lld pages read, %lld writes saved by swap cache, "
+            "%lld cached slots reclaimed\n",
+            swap_write_cnt, swap_read_cnt, swap_reuse_cnt, swap_reclaim_cnt);
+    if (available_slot_bitmap == NULL)
+        return;
+
+    // Fragmentation: slots in use versus clusters still wholly free.
+    size_t free_clusters = 0;
+    size_t c;
+    for (c = 0; c < swap_cluster_count; ++c) {
+        if (bitmap_all (available_slot_bitmap, c * SWAP_CLUSTER_SLOTS, SWAP_CLUSTER_SLOTS))
+            free_clusters++;
+    }
+    printf ("Swap: %zu of %zu slots in use, %zu of %zu clusters free, "
+            "%lld clusters started, %lld slots allocated outside a cluster\n",
+            bitmap_count (available_slot_bitmap, 0, max_swap_page_count, false),
+            max_swap_page_count, free_clusters, swap_cluster_count,
+            swap_cluster_cnt, swap_scatter_cnt);
+    printf ("Swap: %lld pages read ahead, %lld used, %lld evicted unused, window %zu\n",
+            swap_ahead_cnt, swap_ahead_used, swap_ahead_unused, readahead_window);
+    zswap_print_stats ();
+}
+
+
+/**
+ * Allocate a swap slot and return its index.
+ * HINT, if not null, is the slot after the one its owner last swapped out
+ * to; the owner keeps filling that cluster while it has free slots, and
+ * otherwise starts a new one. HINT is advanced past the returned slot.
+ * Swap must not be full. This function MUST be called with swap_lock held.
+ */
+static size_t swap_alloc (uint32_t *hint)
+{
+    ASSERT (lock_held_by_current_thread (&swap_lock));
+
+    if (hint == NULL)
+        hint = &swap_default_hint;
+
+    // 1. Next slot of the owner's current cluster.
+    size_t slot = BITMAP_ERROR;
+    if (*hint != NO_SAWP_INDEX && *hint % SWAP_CLUSTER_SLOTS != 0
+        && *hint < max_swap_page_count && bitmap_test (available_slot_bitmap, *hint))
+        slot = *hint;
+
+    // 2. First slot of the next wholly free cluster, searching next-fit from the cursor.
+    size_t i;
+    for (i = 0; slot == BITMAP_ERROR && i < swap_cluster_count; ++i) {
+        size_t c = (swap_cursor + i) % swap_cluster_count;
+        if (bitmap_all (available_slot_bitmap, c * SWAP_CLUSTER_SLOTS, SWAP_CLUSTER_SLOTS)) {
+            slot = c * SWAP_CLUSTER_SLOTS;
+            swap_cursor = (c + 1) % swap_cluster_count;
+            swap_cluster_cnt++;
+        }
+    }
+
+    // 3. No free cluster is left: take any free slot.
+    if (slot == BITMAP_ERROR) {
+        slot = bitmap_scan (available_slot_bitmap, 0, 1, true);
+        if (slot != BITMAP_ERROR)
+            swap_scatter_cnt++;
+    }
+
+    // 4. No free slot is left: take one that only caches a resident page.
+    if (slot == BITMAP_ERROR) {
+        slot = swap_reclaim ();
+        if (slot == BITMAP_ERROR)
+            PANIC ("Swap is full");
+    }
+
+    // Mark the slot is used
+    bitmap_set (available_slot_bitmap, slot, false);
+    swap_used_cnt++;
+    *hint = slot + 1;
+    return slot;
+}
+
+
+/**
+ * Free a slot kept as a cached copy of a resident page and return its index,
+ * or BITMAP_ERROR if there is none. Its owner finds out when it next uses
+ * the slot, through swap_reuse or swap_drop_cache.
+ * This function MUST be called with swap_lock held.
+ */
+static size_t swap_reclaim (void)
+{
+    ASSERT (lock_held_by_current_thread (&swap_lock));
+
+    size_t i;
+    for (i = 0; i < max_swap_page_count; ++i) {
+        size_t slot = (swap_reclaim_cursor + i) % max_swap_page_count;
+        if (swap_cache_owner[slot] != NULL) {
+            swap_cache_owner[slot] = NULL;
+            zswap_invalidate (slot);
+            bitmap_set (available_slot_bitmap, slot, true);
+            swap_used_cnt--;
+            swap_reclaim_cursor = (slot + 1) % max_swap_page_count;
+            swap_reclaim_cnt++;
+            return slot;
+        }
+    }
+    return BITMAP_ERROR;
+}
+
+
+/**
+ * Write the content in given page to swap_index slot on the swap disk.
+ * This function MUST be called with swap_write_lock held.
+ */
+static void swap_write (uint32_t swap_index, const void *page)
+{
+    ASSERT (lock_held_by_current_thread (&swap_write_lock));
+
+    // Write all content to swap slot
+    size_t i = 0;
+    for (; i < SECTORS_PER_PAGE; ++i) {
+        block_write(swap_slots,
+            /* sector number */  swap_index * SECTORS_PER_PAGE + i,
+            /* target address */ (const char*)page + (BLOCK_SECTOR_SIZE * i));
+    }
+    swap_write_cnt++;
 }
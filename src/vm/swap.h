@@ -1,7 +1,14 @@
 #ifndef VM_SWAP_HEADER
 #define VM_SWAP_HEADER
 
-#define NO_SAWP_INDEX -1
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NO_SAWP_INDEX ((uint32_t) -1)
+
+// Maximum number of slots read ahead after a swap-in.
+#define SWAP_READAHEAD_MAX 8
 
 /**
  * Initialize swap, Must be called ONLY ONCE at the initialization phase.
@@ -12,18 +19,64 @@ void swap_init (void);
 /**
  * Swap out the content in given page into swap disk.
  * Return the index of swap slot in which it is placed.
+ * HINT, if not null, is per-owner allocation state initialized to NO_SAWP_INDEX,
+ * which keeps the owner's pages together on disk.
  */
-uint32_t swap_out (void* page);
+uint32_t swap_out (void* page, uint32_t *hint);
 
 
 /**
- * Read content in in swap_index slot on swap back into given page
+ * Read content in in swap_index slot on swap back into given page.
+ * The slot stays allocated until swap_free or swap_cache is called.
  */
 void swap_in (uint32_t swap_index, void* page);
 
+/**
+ * Read content in swap_index slot into given page ahead of any fault on it,
+ * as swap_in does.
+ */
+void swap_in_ahead (uint32_t swap_index, void* page);
+
+/**
+ * Return how many slots following a swapped-in one should be read ahead.
+ */
+size_t swap_readahead_window (void);
+
+/**
+ * Report whether a page read ahead was USED before it was evicted again,
+ * which grows or shrinks the readahead window.
+ */
+void swap_readahead_feedback (bool used);
+
+/**
+ * Keep swap_index slot, which a now resident page was read in from, caching
+ * its content for OWNER, unless swap is more than half full; otherwise free it.
+ * A kept slot lasts until swap_reuse or swap_drop_cache is called, or until
+ * it is reclaimed for lack of free slots.
+ * Return whether it is kept.
+ */
+bool swap_cache (uint32_t swap_index, const void *owner);
+
+/**
+ * Record that a page still matching its copy in swap_index slot, cached for
+ * OWNER, was evicted back to that slot without writing it.
+ * Return false if the slot was reclaimed meanwhile.
+ */
+bool swap_reuse (uint32_t swap_index, const void *owner);
+
+/**
+ * Drop swap_index slot cached for OWNER, unless it was reclaimed meanwhile.
+ */
+void swap_drop_cache (uint32_t swap_index, const void *owner);
+
 /**
  * Drop swap slot
  */
 void swap_free (uint32_t swap_index);
 
+/**
+ * Print swap statistics.
+ */
+void swap_print_stats (void);
+
 #endif
\ No newline at end of file
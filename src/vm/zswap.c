@@ -0,0 +1,476 @@
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
+
+// Percentage of memory the compressed pages may use. 0 disables zswap.
+int zswap_max_pct = 10;
+
+// Pages compressing to more than this many bytes are left to the swap disk.
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4)
+
+/**
+ * Compressed page, the content of one swap slot.
+ */
+struct zswap_entry
+{
+    uint32_t swap_index;        // Swap slot whose content this is
+    struct hash_elem helem;     // see ::zswap_table
+    struct list_elem lelem;     // see ::zswap_lru, unless writeback == true
+    bool writeback;             // Being written back to the swap disk
+    uint32_t fill;              // Only valid for size == 0 : every word of the page
+    size_t size;                // Compressed size in bytes, or 0 for a same-filled page
+    uint8_t data[];             // Compressed content
+};
+
+#define LZ_HASH_BITS 12                 // Size of the match-finding hash table
+
+/**
+ * Working memory of one compression, private to the compressing thread.
+ */
+struct lz_scratch
+{
+    uint16_t table[1 << LZ_HASH_BITS];  // Last position + 1 at which each 3-byte
+                                        // hash was seen, 0 for none
+    uint8_t out[ZSWAP_MAX_SIZE];        // Compressed output
+};
+
+// Guards everything below.
+static struct lock zswap_lock;
+
+static struct hash zswap_table;     // Compressed pages by swap slot
+static struct list zswap_lru;       // Compressed pages, least recently used first
+static size_t zswap_bytes;          // Memory used by compressed pages
+static size_t zswap_max_bytes;      // Limit on zswap_bytes
+
+// Statistics
+static long long zswap_stored_cnt;      // Pages stored
+static long long zswap_same_cnt;        // ... of which same-filled
+static long long zswap_reject_cnt;      // Pages left to the disk: incompressible or no memory
+static long long zswap_hit_cnt;         // Loads served from zswap
+static long long zswap_miss_cnt;        // Loads that had to go to disk
+static long long zswap_writeback_cnt;   // Pages written back to disk over the limit
+static long long zswap_compressed_bytes; // Total compressed size of pages stored
+
+/**
+ * Helper functions
+ */
+static struct zswap_entry* zswap_find (uint32_t swap_index);
+static void zswap_remove (struct zswap_entry *);
+static void zswap_unpack (const struct zswap_entry *, void *page);
+static bool zswap_same_filled (const void *page, uint32_t *fill);
+static void zswap_count_reject (void);
+static size_t lz_compress (const uint8_t *src, struct lz_scratch *, size_t limit);
+static void lz_decompress (const uint8_t *src, size_t size, uint8_t *dst);
+static unsigned zswap_hash_func (const struct hash_elem *elem, void *aux);
+static bool zswap_less_func (const struct hash_elem *, const struct hash_elem *, void *aux);
+
+
+/**
+ * Initialize zswap, Must be called ONLY ONCE at the initialization phase.
+ */
+void zswap_init (void)
+{
+    lock_init (&zswap_lock);
+    lock_set_name (&zswap_lock, "zswap_lock");
+    hash_init (&zswap_table, zswap_hash_func, zswap_less_func, NULL);
+    list_init (&zswap_lru);
+
+    if (zswap_max_pct < 0 || zswap_max_pct > 100)
+        PANIC ("zswap: invalid memory percentage %d", zswap_max_pct);
+    zswap_max_bytes = (uint64_t) init_ram_pages * PGSIZE * zswap_max_pct / 100;
+}
+
+
+/**
+ * Compress the content in given page into a new compressed page, not yet
+ * stored anywhere. Takes no lock while compressing, so callers should call
+ * this before taking any lock of theirs.
+ * Return NULL if the page does not compress well or memory is short.
+ */
+struct zswap_entry* zswap_compress (const void *page)
+{
+    if (zswap_max_bytes == 0)
+        return NULL;
+
+    // Pages of a single repeated word (mostly zeros) need no data at all.
+    uint32_t fill = 0;
+    size_t size = 0;
+    struct lz_scratch *scratch = NULL;
+    if (!zswap_same_filled (page, &fill)) {
+        scratch = malloc (sizeof *scratch);
+        if (scratch != NULL)
+            size = lz_compress (page, scratch, ZSWAP_MAX_SIZE);
+        if (size == 0) {
+            free (scratch);
+            zswap_count_reject ();
+            return NULL;
+        }
+    }
+
+    struct zswap_entry *entry = malloc (sizeof *entry + size);
+    if (entry == NULL) {
+        free (scratch);
+        zswap_count_reject ();
+        return NULL;
+    }
+    entry->writeback = false;
+    entry->fill = fill;
+    entry->size = size;
+    if (scratch != NULL) {
+        memcpy (entry->data, scratch->out, size);
+        free (scratch);
+    }
+
+    return entry;
+}
+
+
+/**
+ * Keep a compressed page from zswap_compress as the content of swap_index slot.
+ */
+void zswap_store (uint32_t swap_index, struct zswap_entry *entry)
+{
+    entry->swap_index = swap_index;
+
+    lock_acquire (&zswap_lock);
+    ASSERT (zswap_find (swap_index) == NULL);
+
+    hash_insert (&zswap_table, &entry->helem);
+    list_push_back (&zswap_lru, &entry->lelem);
+    zswap_bytes += sizeof *entry + entry->size;
+
+    zswap_stored_cnt++;
+    if (entry->size == 0)
+        zswap_same_cnt++;
+    zswap_compressed_bytes += entry->size;
+    lock_release (&zswap_lock);
+}
+
+
+/**
+ * Decompress the content of swap_index slot into given page, if zswap has it.
+ * Return false if the content is on the swap disk instead.
+ */
+bool zswap_load (uint32_t swap_index, void *page)
+{
+    if (zswap_max_bytes == 0)
+        return false;
+
+    lock_acquire (&zswap_lock);
+    struct zswap_entry *entry = zswap_find (swap_index);
+    if (entry == NULL) {
+        zswap_miss_cnt++;
+        lock_release (&zswap_lock);
+        return false;
+    }
+
+    zswap_unpack (entry, page);
+    if (!entry->writeback) {
+        // Most recently used now.
+        list_remove (&entry->lelem);
+        list_push_back (&zswap_lru, &entry->lelem);
+    }
+    zswap_hit_cnt++;
+    lock_release (&zswap_lock);
+
+    return true;
+}
+
+
+/**
+ * Drop the compressed content of swap_index slot, if any.
+ */
+void zswap_invalidate (uint32_t swap_index)
+{
+    if (zswap_max_bytes == 0)
+        return;
+
+    lock_acquire (&zswap_lock);
+    struct zswap_entry *entry = zswap_find (swap_index);
+    if (entry != NULL)
+        zswap_remove (entry);
+    lock_release (&zswap_lock);
+}
+
+
+/**
+ * If zswap is over its memory limit, decompress its least recently used page
+ * into given page and store its slot in *swap_index, and return true. The
+ * caller must write the page to that slot on disk and then call
+ * zswap_writeback_end; until then the compressed copy still serves loads.
+ */
+bool zswap_writeback_begin (uint32_t *swap_index, void *page)
+{
+    bool found = false;
+
+    lock_acquire (&zswap_lock);
+    if (zswap_bytes > zswap_max_bytes && !list_empty (&zswap_lru)) {
+        struct zswap_entry *entry = list_entry (list_pop_front (&zswap_lru),
+                                                struct zswap_entry, lelem);
+        entry->writeback = true;
+        zswap_unpack (entry, page);
+        *swap_index = entry->swap_index;
+        found = true;
+    }
+    lock_release (&zswap_lock);
+
+    return found;
+}
+
+
+/**
+ * Drop the compressed copy of swap_index slot once it has been written back.
+ */
+void zswap_writeback_end (uint32_t swap_index)
+{
+    lock_acquire (&zswap_lock);
+    struct zswap_entry *entry = zswap_find (swap_index);
+
+    // The slot may have been freed, and even stored again, meanwhile.
+    if (entry != NULL && entry->writeback) {
+        zswap_remove (entry);
+        zswap_writeback_cnt++;
+    }
+    lock_release (&zswap_lock);
+}
+
+
+/**
+ * Print zswap statistics.
+ */
+void zswap_print_stats (void)
+{
+    long long loads = zswap_hit_cnt + zswap_miss_cnt;
+    long long stored_pages = zswap_stored_cnt - zswap_same_cnt;
+
+    printf ("Zswap: %lld pages stored (%lld same-filled), %lld rejected, "
+            "%lld written back, %zu of %zu bytes in use\n",
+            zswap_stored_cnt, zswap_same_cnt, zswap_reject_cnt,
+            zswap_writeback_cnt, zswap_bytes, zswap_max_bytes);
+    printf ("Zswap: %lld hits, %lld misses (%lld%% hit rate), "
+            "compression ratio %lld%% excluding same-filled pages\n",
+            zswap_hit_cnt, zswap_miss_cnt,
+            loads > 0 ? zswap_hit_cnt * 100 / loads : 0,
+            stored_pages > 0 ? zswap_compressed_bytes * 100 / (stored_pages * PGSIZE) : 0);
+}
+
+
+/** ======================================================
+ *  Helper functions
+ *  ======================================================
+ */
+
+/**
+ * Lookup the compressed page for swap_index slot, or NULL.
+ * This function MUST be called with zswap_lock held.
+ */
+static struct zswap_entry* zswap_find (uint32_t swap_index)
+{
+    struct zswap_entry temp;
+    temp.swap_index = swap_index;
+
+    struct hash_elem *elem = hash_find (&zswap_table, &temp.helem);
+    return elem != NULL ? hash_entry (elem, struct zswap_entry, helem) : NULL;
+}
+
+
+/**
+ * Remove a compressed page and free its memory.
+ * This function MUST be called with zswap_lock held.
+ */
+static void zswap_remove (struct zswap_entry *entry)
+{
+    hash_delete (&zswap_table, &entry->helem);
+    if (!entry->writeback)
+        list_remove (&entry->lelem);
+    zswap_bytes -= sizeof *entry + entry->size;
+    free (entry);
+}
+
+
+/**
+ * Decompress a compressed page into given page.
+ */
+static void zswap_unpack (const struct zswap_entry *entry, void *page)
+{
+    if (entry->size == 0) {
+        uint32_t *word = page;
+        size_t i;
+        for (i = 0; i < PGSIZE / sizeof *word; ++i)
+            word[i] = entry->fill;
+    }
+    else
+        lz_decompress (entry->data, entry->size, page);
+}
+
+
+/**
+ * Count a page left to the swap disk.
+ */
+static void zswap_count_reject (void)
+{
+    lock_acquire (&zswap_lock);
+    zswap_reject_cnt++;
+    lock_release (&zswap_lock);
+}
+
+
+/**
+ * Return whether every word of the page is the same, storing it in *fill.
+ */
+static bool zswap_same_filled (const void *page, uint32_t *fill)
+{
+    const uint32_t *word = page;
+    size_t i;
+
+    for (i = 1; i < PGSIZE / sizeof *word; ++i) {
+        if (word[i] != word[0])
+            return false;
+    }
+    *fill = word[0];
+    return true;
+}
+
+
+/** ======================================================
+ *  LZ77 compressor, in the style of LZRW1.
+ *
+ *  The compressed stream is a sequence of groups of up to 8 items, each
+ *  group preceded by a control byte whose bit i tells whether item i is a
+ *  literal byte (0) or a match (1). A match copies LEN bytes from OFFSET
+ *  bytes back in the output and takes 2 bytes: OFFSET's low 8 bits, then
+ *  its high 4 bits above LEN - 3. When LEN - 3 would not fit in 4 bits, they
+ *  are 15 and a third byte holds LEN - 18.
+ *  ======================================================
+ */
+
+#define LZ_MIN_MATCH 3                  // Shorter matches are stored as literals
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + 15 + 255)
+#define LZ_MAX_OFFSET 4095
+
+// Hash of the 3 bytes at p.
+static inline unsigned lz_hash (const uint8_t *p)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+
+/**
+ * Compress the page at src into scratch->out.
+ * Return the compressed size, or 0 if it would be more than limit bytes.
+ */
+static size_t lz_compress (const uint8_t *src, struct lz_scratch *scratch, size_t limit)
+{
+    uint16_t *lz_table = scratch->table;
+    uint8_t *dst = scratch->out;
+    size_t ip = 0, op = 0, ctrl = 0;
+    int item = 8;
+
+    memset (lz_table, 0, sizeof scratch->table);
+    while (ip < PGSIZE) {
+        // Start a new group.
+        if (item == 8) {
+            if (op + 1 > limit)
+                return 0;
+            ctrl = op++;
+            dst[ctrl] = 0;
+            item = 0;
+        }
+
+        // Look for the longest match at the last position with the same hash.
+        size_t len = 0, offset = 0;
+        if (ip + LZ_MIN_MATCH <= PGSIZE) {
+            unsigned h = lz_hash (src + ip);
+            size_t cand = lz_table[h];
+            lz_table[h] = ip + 1;
+            if (cand != 0 && ip - (cand - 1) <= LZ_MAX_OFFSET) {
+                const uint8_t *m = src + cand - 1;
+                while (ip + len < PGSIZE && len < LZ_MAX_MATCH && m[len] == src[ip + len])
+                    len++;
+                offset = ip - (cand - 1);
+            }
+        }
+
+        if (len >= LZ_MIN_MATCH) {
+            size_t code = len - LZ_MIN_MATCH;
+            if (op + (code >= 15 ? 3 : 2) > limit)
+                return 0;
+            dst[ctrl] |= 1 << item;
+            dst[op++] = offset & 0xff;
+            dst[op++] = ((offset >> 8) << 4) | (code >= 15 ? 15 : code);
+            if (code >= 15)
+                dst[op++] = code - 15;
+            ip += len;
+        } else {
+            if (op + 1 > limit)
+                return 0;
+            dst[op++] = src[ip++];
+        }
+        item++;
+    }
+
+    return op;
+}
+
+
+/**
+ * Decompress size bytes at src, produced by lz_compress, into the page at dst.
+ */
+static void lz_decompress (const uint8_t *src, size_t size, uint8_t *dst)
+{
+    size_t ip = 0, op = 0;
+
+    while (ip < size) {
+        uint8_t ctrl = src[ip++];
+        int item;
+        for (item = 0; item < 8 && ip < size; ++item) {
+            if (ctrl & (1 << item)) {
+                size_t offset = src[ip] | ((src[ip + 1] >> 4) << 8);
+                size_t len = (src[ip + 1] & 15) + LZ_MIN_MATCH;
+                ip += 2;
+                if (len == LZ_MIN_MATCH + 15)
+                    len += src[ip++];
+
+                ASSERT (offset > 0 && offset <= op && op + len <= PGSIZE);
+                for (; len > 0; --len, ++op)
+                    dst[op] = dst[op - offset];
+            }
+            else
+                dst[op++] = src[ip++];
+        }
+    }
+
+    ASSERT (op == PGSIZE);
+}
+
+
+/* =============================================================
+ * Implementation of helper functions for hash table operations
+ * =============================================================
+ */
+
+// Get hash for an element, using its swap slot as key
+static unsigned zswap_hash_func (const struct hash_elem *elem, void *aux UNUSED)
+{
+    struct zswap_entry *entry = hash_entry (elem, struct zswap_entry, helem);
+
+    return hash_int ((int) entry->swap_index);
+}
+
+
+// Compare two elements' keys : whether a < b
+static bool zswap_less_func (const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+{
+    struct zswap_entry *a_entry = hash_entry (a, struct zswap_entry, helem);
+    struct zswap_entry *b_entry = hash_entry (b, struct zswap_entry, helem);
+
+    return a_entry->swap_index < b_entry->swap_index;
+}
@@ -0,0 +1,69 @@
+#ifndef VM_ZSWAP_HEADER
+#define VM_ZSWAP_HEADER
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Compressed swap cache (zswap).
+ *
+ * Pages being swapped out are compressed into kernel memory, keyed by the
+ * swap slot allocated for them, instead of being written to the swap disk.
+ * Swap-ins of those slots are served by decompressing. When the compressed
+ * pages take more than zswap_max_pct percent of memory, the least recently
+ * used ones are written back to their slots on disk.
+ */
+
+// Percentage of memory the compressed pages may use. 0 disables zswap.
+extern int zswap_max_pct;
+
+/**
+ * Initialize zswap, Must be called ONLY ONCE at the initialization phase.
+ */
+void zswap_init (void);
+
+struct zswap_entry;
+
+/**
+ * Compress the content in given page into a new compressed page, not yet
+ * stored anywhere. Takes no lock while compressing, so callers should call
+ * this before taking any lock of theirs.
+ * Return NULL if the page does not compress well or memory is short.
+ */
+struct zswap_entry* zswap_compress (const void *page);
+
+/**
+ * Keep a compressed page from zswap_compress as the content of swap_index slot.
+ */
+void zswap_store (uint32_t swap_index, struct zswap_entry *);
+
+/**
+ * Decompress the content of swap_index slot into given page, if zswap has it.
+ * Return false if the content is on the swap disk instead.
+ */
+bool zswap_load (uint32_t swap_index, void *page);
+
+/**
+ * Drop the compressed content of swap_index slot, if any.
+ */
+void zswap_invalidate (uint32_t swap_index);
+
+/**
+ * If zswap is over its memory limit, decompress its least recently used page
+ * into given page and store its slot in *swap_index, and return true. The
+ * caller must write the page to that slot on disk and then call
+ * zswap_writeback_end; until then the compressed copy still serves loads.
+ */
+bool zswap_writeback_begin (uint32_t *swap_index, void *page);
+
+/**
+ * Drop the compressed copy of swap_index slot once it has been written back.
+ */
+void zswap_writeback_end (uint32_t swap_index);
+
+/**
+ * Print zswap statistics.
+ */
+void zswap_print_stats (void);
+
+#endif